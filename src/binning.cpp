@@ -0,0 +1,77 @@
+#include <cassert>
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "binning.h"
+
+using namespace std;
+
+/* acc[i] += src[i] for n elements, widening from 32 to 64 bits */
+static inline void accumulate_row(uint64_t * acc, const uint32_t * src, hsize_t n)
+{
+    hsize_t i = 0;
+#ifdef __SSE2__
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 4 <= n; i += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        __m128i lo = _mm_unpacklo_epi32(v, zero);
+        __m128i hi = _mm_unpackhi_epi32(v, zero);
+        __m128i * a = reinterpret_cast<__m128i *>(acc + i);
+        _mm_storeu_si128(a, _mm_add_epi64(_mm_loadu_si128(a), lo));
+        _mm_storeu_si128(a + 1, _mm_add_epi64(_mm_loadu_si128(a + 1), hi));
+    }
+#endif
+    for (; i < n; i++) acc[i] += src[i];
+}
+
+FrameBinner::FrameBinner()
+: m_rows(0), m_cols(0), m_bin(1)
+{
+}
+
+void FrameBinner::configure(hsize_t rows, hsize_t cols, unsigned int bin)
+{
+    assert(bin >= 1);
+    m_rows = rows;
+    m_cols = cols;
+    m_bin = bin;
+    m_acc.assign(this->out_cols() * m_bin, 0);
+}
+
+hsize_t FrameBinner::out_rows() const
+{
+    return m_rows / m_bin;
+}
+
+hsize_t FrameBinner::out_cols() const
+{
+    return m_cols / m_bin;
+}
+
+size_t FrameBinner::out_items() const
+{
+    return this->out_rows() * this->out_cols();
+}
+
+void FrameBinner::bin(const uint32_t * src, uint32_t * dst)
+{
+    hsize_t ncols = this->out_cols() * m_bin;  // input columns used
+    uint64_t norm = static_cast<uint64_t>(m_bin) * m_bin;
+    for (hsize_t orow = 0; orow < this->out_rows(); orow++) {
+        fill(m_acc.begin(), m_acc.end(), 0);
+        const uint32_t * row = src + orow * m_bin * m_cols;
+        for (unsigned int r = 0; r < m_bin; r++) {
+            accumulate_row(&m_acc[0], row + r * m_cols, ncols);
+        }
+        const uint64_t * acc = &m_acc[0];
+        for (hsize_t ocol = 0; ocol < this->out_cols(); ocol++) {
+            uint64_t sum = 0;
+            for (unsigned int c = 0; c < m_bin; c++) sum += acc[c];
+            acc += m_bin;
+            dst[orow * this->out_cols() + ocol] = static_cast<uint32_t>(sum / norm);
+        }
+    }
+}
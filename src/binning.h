@@ -0,0 +1,36 @@
+/*
+ * binning.h
+ *
+ * Binning (decimation) of 2D frames for live preview.
+ *
+ * Each output pixel is the mean of a bin x bin block of input pixels. Rows
+ * and columns which do not fill a whole bin at the bottom and right edges
+ * are dropped. The input rows of a bin are first summed vertically into a
+ * row of 64 bit accumulators, which is the bulk of the work and is done with
+ * SSE2 where available, and then summed horizontally per bin.
+ */
+
+#ifndef BINNING_H_
+#define BINNING_H_
+
+#include <vector>
+#include <stdint.h>
+#include <hdf5.h>
+
+class FrameBinner {
+public:
+    FrameBinner();
+    void configure(hsize_t rows, hsize_t cols, unsigned int bin);
+    void bin(const uint32_t * src, uint32_t * dst);
+    hsize_t out_rows() const;
+    hsize_t out_cols() const;
+    size_t out_items() const;
+
+private:
+    hsize_t m_rows;
+    hsize_t m_cols;
+    unsigned int m_bin;
+    std::vector<uint64_t> m_acc;   // one row of vertical sums
+};
+
+#endif /* BINNING_H_ */
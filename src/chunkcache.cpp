@@ -0,0 +1,82 @@
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+
+#include "chunkcache.h"
+
+using namespace std;
+
+hsize_t chunks_in_region(const hsize_t chunk_dims[3], hsize_t row, hsize_t col,
+                         hsize_t rows, hsize_t cols)
+{
+    if (rows == 0 || cols == 0) return 0;
+    hsize_t chunk_rows = (row + rows - 1) / chunk_dims[1] - row / chunk_dims[1] + 1;
+    hsize_t chunk_cols = (col + cols - 1) / chunk_dims[2] - col / chunk_dims[2] + 1;
+    return chunk_rows * chunk_cols;
+}
+
+static hsize_t tiles_per_frame(const hsize_t frame_dims[2], const hsize_t chunk_dims[3])
+{
+    return chunks_in_region(chunk_dims, 0, 0, frame_dims[0], frame_dims[1]);
+}
+
+size_t next_prime(size_t n)
+{
+    if (n <= 2) return 2;
+    if (n % 2 == 0) n++;
+    for (;; n += 2) {
+        bool prime = true;
+        for (size_t d = 3; d * d <= n; d += 2) {
+            if (n % d == 0) { prime = false; break; }
+        }
+        if (prime) return n;
+    }
+}
+
+ChunkCacheConfig tune_chunk_cache(const hsize_t frame_dims[2],
+                                  const hsize_t chunk_dims[3],
+                                  size_t elem_size,
+                                  unsigned int slabs_in_flight,
+                                  double w0,
+                                  double cache_mb)
+{
+    ChunkCacheConfig config;
+    config.chunk_bytes = chunk_dims[0] * chunk_dims[1] * chunk_dims[2] * elem_size;
+    config.w0 = w0;
+    if (cache_mb > 0.) {
+        config.nbytes = static_cast<size_t>(cache_mb * 1024 * 1024);
+    } else {
+        size_t nchunks = tiles_per_frame(frame_dims, chunk_dims) * slabs_in_flight;
+        config.nbytes = nchunks > 0 ? nchunks * config.chunk_bytes : config.chunk_bytes - 1;
+    }
+    size_t nchunks = config.chunk_bytes > 0 ? config.nbytes / config.chunk_bytes : 0;
+    config.nslots = next_prime(nchunks * 100 > 521 ? nchunks * 100 : 521);
+    return config;
+}
+
+void print_chunk_cache(ostream& os, const ChunkCacheConfig& config,
+                       const ChunkCacheCounters& counters)
+{
+    size_t nchunks = config.chunk_bytes > 0 ? config.nbytes / config.chunk_bytes : 0;
+    os << " Chunk cache:         " << config.nslots << " slots, "
+       << config.nbytes << " bytes (" << nchunks << " chunks), w0="
+       << fixed << setprecision(2) << config.w0;
+    if (nchunks == 0) os << ": chunks bypass the cache";
+    os << endl;
+
+    os << "  chunk accesses:     " << counters.accesses;
+    if (!counters.traced) {
+        os << " (hits not counted: use the trace driver)" << endl;
+        return;
+    }
+    /* A chunk accessed directly may take more than one raw data read or
+     * write, one per contiguous piece */
+    unsigned long long misses = min(counters.raw_io, counters.accesses);
+    unsigned long long hits = counters.accesses - misses;
+    os << " (hits: " << hits << " misses: " << misses
+       << ", raw data I/O: " << counters.raw_io << ")";
+    if (counters.accesses > 0) {
+        os << setprecision(1) << " hit rate: " << 100.0 * hits / counters.accesses << "%";
+    }
+    os << endl;
+}
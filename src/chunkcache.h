@@ -0,0 +1,63 @@
+/*
+ * chunkcache.h
+ *
+ * Raw data chunk cache sizing for the writer and reader.
+ *
+ * The tuner sizes the cache to hold the chunks in flight: all the chunks
+ * which a frame touches (the tiles of a frame) times the number of such
+ * slabs which are being accessed at once. The number of hash slots is a
+ * prime of about 100 times the number of chunks which fit in the cache, as
+ * recommended for H5Pset_chunk_cache(), to keep collisions rare.
+ *
+ * A cache only pays off while the dataset stays open: the library drops it
+ * when the dataset is closed. With no slabs in flight the cache is kept
+ * smaller than a chunk, so partial chunk reads go straight to the file
+ * instead of reading in whole chunks to be thrown away.
+ *
+ * A size given by the user (cache_mb > 0) overrides the tuned size.
+ *
+ * The library does not count chunk cache hits, so they are counted from
+ * outside: every chunk which a frame or region read or write touches is an
+ * access, and every raw data read or write which reaches the file during
+ * those calls is a miss: a chunk read in, a chunk evicted to make room, or
+ * a chunk accessed directly because it does not fit in the cache. The raw
+ * data I/O is only seen when the file is opened with the trace driver
+ * (tracevfd.h).
+ */
+
+#ifndef CHUNKCACHE_H_
+#define CHUNKCACHE_H_
+
+#include <ostream>
+#include <hdf5.h>
+
+struct ChunkCacheConfig {
+    size_t nslots;
+    size_t nbytes;
+    double w0;
+    size_t chunk_bytes;
+};
+
+struct ChunkCacheCounters {
+    ChunkCacheCounters() : accesses(0), raw_io(0), traced(false) {}
+    unsigned long long accesses;     // chunks touched by frame reads/writes
+    unsigned long long raw_io;       // raw data reads/writes reaching the file meanwhile
+    bool traced;                     // raw_io was counted
+};
+
+ChunkCacheConfig tune_chunk_cache(const hsize_t frame_dims[2],
+                                  const hsize_t chunk_dims[3],
+                                  size_t elem_size,
+                                  unsigned int slabs_in_flight,
+                                  double w0,
+                                  double cache_mb = 0.0);
+
+hsize_t chunks_in_region(const hsize_t chunk_dims[3], hsize_t row, hsize_t col,
+                         hsize_t rows, hsize_t cols);
+
+size_t next_prime(size_t n);
+
+void print_chunk_cache(std::ostream& os, const ChunkCacheConfig& config,
+                       const ChunkCacheCounters& counters);
+
+#endif /* CHUNKCACHE_H_ */
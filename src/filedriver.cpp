@@ -0,0 +1,83 @@
+#include <stdexcept>
+
+#include "hdf5.h"
+#include "filedriver.h"
+
+using namespace std;
+
+// Core driver memory is grown in steps of this size
+static const size_t CORE_INCREMENT = 64 * 1024 * 1024;
+
+// Direct driver: O_DIRECT buffers must be aligned to the file system block
+static const size_t DIRECT_ALIGNMENT = 4096;
+static const size_t DIRECT_BLOCK_SIZE = 4096;
+static const size_t DIRECT_CBUF_SIZE = 16 * 1024 * 1024;
+
+FileDriver parse_file_driver(const string& name)
+{
+    if (name == "sec2") return DRIVER_SEC2;
+    if (name == "core") return DRIVER_CORE;
+    if (name == "stdio") return DRIVER_STDIO;
+    if (name == "direct") return DRIVER_DIRECT;
+    if (name == "trace") return DRIVER_TRACE;
+    throw logic_error("Unknown file driver: " + name);
+}
+
+const char * file_driver_name(FileDriver driver)
+{
+    switch (driver) {
+    case DRIVER_SEC2:   return "sec2";
+    case DRIVER_CORE:   return "core";
+    case DRIVER_STDIO:  return "stdio";
+    case DRIVER_DIRECT: return "direct";
+    case DRIVER_TRACE:  return "trace";
+    default:            return "unknown";
+    }
+}
+
+bool file_driver_available(FileDriver driver)
+{
+#ifdef H5_HAVE_DIRECT
+    return true;
+#else
+    return driver != DRIVER_DIRECT;
+#endif
+}
+
+bool file_driver_supports_swmr(FileDriver driver)
+{
+    return driver == DRIVER_SEC2 || driver == DRIVER_DIRECT ||
+           driver == DRIVER_TRACE;
+}
+
+void set_fapl_driver(hid_t fapl, FileDriver driver, bool backing_store)
+{
+    if (!file_driver_available(driver)) {
+        throw runtime_error(string("File driver not built into the HDF5 library: ")
+                            + file_driver_name(driver));
+    }
+    herr_t status = 0;
+    switch (driver) {
+    case DRIVER_SEC2:
+        status = H5Pset_fapl_sec2(fapl);
+        break;
+    case DRIVER_CORE:
+        status = H5Pset_fapl_core(fapl, CORE_INCREMENT, backing_store);
+        break;
+    case DRIVER_STDIO:
+        status = H5Pset_fapl_stdio(fapl);
+        break;
+    case DRIVER_DIRECT:
+#ifdef H5_HAVE_DIRECT
+        status = H5Pset_fapl_direct(fapl, DIRECT_ALIGNMENT, DIRECT_BLOCK_SIZE,
+                                    DIRECT_CBUF_SIZE);
+#endif
+        break;
+    case DRIVER_TRACE:
+        throw logic_error("The trace driver is set with IoTrace::set_fapl()");
+    }
+    if (status < 0) {
+        throw runtime_error(string("Unable to set the file driver: ")
+                            + file_driver_name(driver));
+    }
+}
@@ -0,0 +1,36 @@
+/*
+ * filedriver.h
+ *
+ * Selection of the HDF5 virtual file driver used to create the data file.
+ *
+ * The core driver keeps the whole file in memory (optionally writing it to
+ * the backing store when the file is closed), which takes storage out of
+ * the benchmark and leaves only the library overhead. Only sec2 and direct
+ * support SWMR I/O: with the other drivers the file is written without
+ * SWMR mode and readers can not follow it.
+ *
+ * set_fapl_driver() sets the plain drivers. The trace driver takes its own
+ * settings and is set with IoTrace::set_fapl() (tracevfd.h).
+ */
+
+#ifndef FILEDRIVER_H_
+#define FILEDRIVER_H_
+
+#include <string>
+#include <hdf5.h>
+
+enum FileDriver {
+    DRIVER_SEC2 = 0,
+    DRIVER_CORE,
+    DRIVER_STDIO,
+    DRIVER_DIRECT,
+    DRIVER_TRACE             // sec2 with I/O tracing, see tracevfd.h
+};
+
+FileDriver parse_file_driver(const std::string& name);
+const char * file_driver_name(FileDriver driver);
+bool file_driver_available(FileDriver driver);
+bool file_driver_supports_swmr(FileDriver driver);
+void set_fapl_driver(hid_t fapl, FileDriver driver, bool backing_store);
+
+#endif /* FILEDRIVER_H_ */
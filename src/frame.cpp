@@ -182,6 +182,19 @@ bool Frame::is_equal(const Frame& src)
     return true; // all matched up
 }
 
+bool Frame::region_equal(const uint32_t * pdata, const FrameRegion& region)
+{
+    // pdata is a buffer with the same dimensions as this frame
+    assert(region.row + region.rows <= m_dims[0]);
+    assert(region.col + region.cols <= m_dims[1]);
+    for (hsize_t r = region.row; r < region.row + region.rows; r++) {
+        size_t start = r * m_dims[1] + region.col;
+        if (memcmp(m_pdata + start, pdata + start, region.cols * sizeof(uint32_t)) != 0)
+            return false; // mismatch
+    }
+    return true; // all matched up
+}
+
 unsigned long long multiply(unsigned long long x, unsigned long long y)
 {
     return x * y;
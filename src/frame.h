@@ -16,6 +16,14 @@
 
 #include "hdf5.h"
 
+/* A rectangular region of a 2D frame */
+struct FrameRegion {
+    hsize_t row;
+    hsize_t col;
+    hsize_t rows;
+    hsize_t cols;
+};
+
 class Frame {
 public:
     Frame();
@@ -31,6 +39,7 @@ public:
     const uint32_t * pdata();
     size_t num_bytes_img();
     size_t num_bytes_chunk();
+    bool region_equal(const uint32_t * pdata, const FrameRegion& region);
 
     // Operators
     Frame& operator=(const Frame& src); // assignment
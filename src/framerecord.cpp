@@ -0,0 +1,14 @@
+#include <assert.h>
+
+#include "framerecord.h"
+
+hid_t create_frame_record_type()
+{
+    hid_t type = H5Tcreate(H5T_COMPOUND, sizeof(FrameRecord));
+    assert(type >= 0);
+    assert(H5Tinsert(type, "frame", HOFFSET(FrameRecord, frame), H5T_NATIVE_UINT64) >= 0);
+    assert(H5Tinsert(type, "timestamp_ns", HOFFSET(FrameRecord, timestamp_ns), H5T_NATIVE_UINT64) >= 0);
+    assert(H5Tinsert(type, "exposure", HOFFSET(FrameRecord, exposure), H5T_NATIVE_DOUBLE) >= 0);
+    assert(H5Tinsert(type, "counts", HOFFSET(FrameRecord, counts), H5T_NATIVE_UINT64) >= 0);
+    return type;
+}
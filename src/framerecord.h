@@ -0,0 +1,27 @@
+/*
+ * framerecord.h
+ *
+ * Fixed size per-frame metadata record, appended by the writer next to the
+ * image dataset through the packet table API and read back incrementally by
+ * the reader.
+ */
+
+#ifndef FRAMERECORD_H_
+#define FRAMERECORD_H_
+
+#include <stdint.h>
+#include <hdf5.h>
+
+#define FRAME_RECORDS_DSET "frame_records"
+
+struct FrameRecord {
+    uint64_t frame;          // index of the frame in the image dataset
+    uint64_t timestamp_ns;   // CLOCK_MONOTONIC when the frame was written
+    double exposure;         // [s], the frame period when paced, else 0
+    uint64_t counts;         // sum of the pixel values
+};
+
+/* Compound datatype matching FrameRecord. The caller closes it. */
+hid_t create_frame_record_type();
+
+#endif /* FRAMERECORD_H_ */
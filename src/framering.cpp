@@ -0,0 +1,140 @@
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <assert.h>
+#include <sched.h>
+
+#include "framering.h"
+
+using namespace std;
+
+// Spins with a CPU pause before yielding the CPU
+static const unsigned int SPINS_BEFORE_YIELD = 1000;
+
+static void * aligned_alloc_lines(size_t bytes)
+{
+    void * ptr = NULL;
+    if (posix_memalign(&ptr, FRAMERING_CACHE_LINE, bytes) != 0) {
+        throw runtime_error("FrameRing: unable to allocate the slots");
+    }
+    memset(ptr, 0, bytes);
+    return ptr;
+}
+
+FrameRing::FrameRing(size_t nslots, size_t slot_bytes, bool multi_producer)
+: m_multi_producer(multi_producer)
+{
+    if (nslots < 2 || (nslots & (nslots - 1)) != 0) {
+        throw logic_error("FrameRing: the number of slots must be a power of two");
+    }
+    m_nslots = nslots;
+    m_mask = nslots - 1;
+    m_slot_bytes = (slot_bytes + FRAMERING_CACHE_LINE - 1) & ~size_t(FRAMERING_CACHE_LINE - 1);
+    if (m_slot_bytes == 0) m_slot_bytes = FRAMERING_CACHE_LINE;
+
+    m_positions = static_cast<Position *>(aligned_alloc_lines(2 * sizeof(Position)));
+    m_headers = static_cast<SlotHeader *>(aligned_alloc_lines(nslots * sizeof(SlotHeader)));
+    m_data = static_cast<char *>(aligned_alloc_lines(nslots * m_slot_bytes));
+    for (size_t s = 0; s < nslots; s++) m_headers[s].seq = s;
+}
+
+FrameRing::~FrameRing()
+{
+    free(m_data);
+    free(m_headers);
+    free(m_positions);
+}
+
+void FrameRing::relax(unsigned int& spins)
+{
+    if (++spins < SPINS_BEFORE_YIELD) {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    } else {
+        spins = 0;
+        sched_yield();
+    }
+}
+
+bool FrameRing::try_claim(uint64_t& ticket)
+{
+    Position& head = m_positions[0];
+    uint64_t pos = __atomic_load_n(&head.next, __ATOMIC_RELAXED);
+    for (;;) {
+        uint64_t seq = __atomic_load_n(&m_headers[pos & m_mask].seq, __ATOMIC_ACQUIRE);
+        int64_t diff = static_cast<int64_t>(seq - pos);
+        if (diff < 0) return false;          // not released from the last lap: full
+        if (diff > 0) {                      // claimed by another producer
+            pos = __atomic_load_n(&head.next, __ATOMIC_RELAXED);
+            continue;
+        }
+        if (!m_multi_producer) {
+            __atomic_store_n(&head.next, pos + 1, __ATOMIC_RELAXED);
+            break;
+        }
+        // On failure pos is reloaded with the current position
+        if (__atomic_compare_exchange_n(&head.next, &pos, pos + 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+    }
+    ticket = pos;
+    return true;
+}
+
+uint64_t FrameRing::claim()
+{
+    uint64_t ticket = 0;
+    unsigned int spins = 0;
+    while (!this->try_claim(ticket)) {
+        __atomic_fetch_add(&m_positions[0].spins, 1, __ATOMIC_RELAXED);
+        relax(spins);
+    }
+    return ticket;
+}
+
+void FrameRing::publish(uint64_t ticket)
+{
+    __atomic_store_n(&m_headers[ticket & m_mask].seq, ticket + 1, __ATOMIC_RELEASE);
+}
+
+bool FrameRing::try_consume(uint64_t& ticket)
+{
+    Position& tail = m_positions[1];
+    uint64_t pos = tail.next;
+    uint64_t seq = __atomic_load_n(&m_headers[pos & m_mask].seq, __ATOMIC_ACQUIRE);
+    if (seq != pos + 1) return false;        // not published yet: empty
+    tail.next = pos + 1;
+    ticket = pos;
+    return true;
+}
+
+uint64_t FrameRing::consume()
+{
+    uint64_t ticket = 0;
+    unsigned int spins = 0;
+    while (!this->try_consume(ticket)) {
+        m_positions[1].spins++;
+        relax(spins);
+    }
+    return ticket;
+}
+
+void FrameRing::release(uint64_t ticket)
+{
+    __atomic_store_n(&m_headers[ticket & m_mask].seq, ticket + m_nslots, __ATOMIC_RELEASE);
+}
+
+void * FrameRing::slot(uint64_t ticket) const
+{
+    return m_data + (ticket & m_mask) * m_slot_bytes;
+}
+
+uint64_t FrameRing::full_spins() const
+{
+    return __atomic_load_n(&m_positions[0].spins, __ATOMIC_RELAXED);
+}
+
+uint64_t FrameRing::empty_spins() const
+{
+    return m_positions[1].spins;
+}
@@ -0,0 +1,77 @@
+/*
+ * framering.h
+ *
+ * Bounded lock-free ring of frame slots, for handing frames from one
+ * pipeline stage to the next (e.g. from a producer to the thread which
+ * makes the HDF5 calls, or from a reading to a verifying thread).
+ *
+ * Every slot has a frame buffer and a sequence number. Slots are claimed
+ * and consumed with increasing tickets: the slot for ticket t is free for
+ * the producer while its sequence number is t, holds a frame for the
+ * consumer once published (t+1) and is free again for the next lap once
+ * released (t+nslots). The producer and consumer positions and each slot
+ * header have a cache line of their own, so the two sides only share the
+ * lines of the slots being handed over. There is a single consumer and a
+ * single producer, or any number of producers with multi_producer, where
+ * claims take a compare-and-swap on the producer position.
+ *
+ * The try_ calls never block. claim() and consume() spin with a CPU pause
+ * and yield the CPU after a while. The number of spins on either side
+ * shows how often the ring ran full or empty.
+ */
+
+#ifndef FRAMERING_H_
+#define FRAMERING_H_
+
+#include <cstddef>
+#include <stdint.h>
+
+#define FRAMERING_CACHE_LINE 64
+
+class FrameRing {
+public:
+    FrameRing(size_t nslots, size_t slot_bytes, bool multi_producer = false);
+    ~FrameRing();
+
+    /* Producer side */
+    bool try_claim(uint64_t& ticket);
+    uint64_t claim();
+    void publish(uint64_t ticket);
+
+    /* Consumer side */
+    bool try_consume(uint64_t& ticket);
+    uint64_t consume();
+    void release(uint64_t ticket);
+
+    void * slot(uint64_t ticket) const;
+    size_t nslots() const { return m_nslots; }
+    size_t slot_bytes() const { return m_slot_bytes; }
+    bool multi_producer() const { return m_multi_producer; }
+    uint64_t full_spins() const;      // claim() waiting for a free slot
+    uint64_t empty_spins() const;     // consume() waiting for a frame
+
+private:
+    FrameRing(const FrameRing&);            // not copyable
+    FrameRing& operator=(const FrameRing&);
+
+    struct SlotHeader {
+        uint64_t seq;
+        char pad[FRAMERING_CACHE_LINE - sizeof(uint64_t)];
+    };
+    struct Position {
+        uint64_t next;                // next ticket
+        uint64_t spins;
+        char pad[FRAMERING_CACHE_LINE - 2 * sizeof(uint64_t)];
+    };
+    static void relax(unsigned int& spins);
+
+    size_t m_nslots;
+    size_t m_mask;
+    size_t m_slot_bytes;              // rounded up to a cache line
+    bool m_multi_producer;
+    Position * m_positions;           // [0]: producer, [1]: consumer
+    SlotHeader * m_headers;
+    char * m_data;
+};
+
+#endif /* FRAMERING_H_ */
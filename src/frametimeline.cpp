@@ -0,0 +1,84 @@
+#include <cmath>
+#include <iomanip>
+
+#include "frametimeline.h"
+
+using namespace std;
+
+FrameTimeline::FrameTimeline(double gap_factor)
+: m_gap_factor(gap_factor), m_frames(0), m_span_s(0.0), m_rate_hz(0.0),
+  m_jitter_ns(0.0), m_backwards(0), m_gaps(0), m_missed_slots(0),
+  m_longest_gap_ns(0), m_longest_gap_frame(0)
+{
+}
+
+void FrameTimeline::analyse(const vector<uint64_t>& timestamps_ns)
+{
+    m_frames = timestamps_ns.size();
+    m_intervals.reset();
+    m_span_s = m_rate_hz = m_jitter_ns = 0.0;
+    m_backwards = m_gaps = m_missed_slots = 0;
+    m_longest_gap_ns = m_longest_gap_frame = 0;
+    if (m_frames < 2) return;
+
+    double sum = 0.0;
+    double sq_sum = 0.0;
+    for (size_t i = 1; i < timestamps_ns.size(); i++) {
+        if (timestamps_ns[i] < timestamps_ns[i-1]) {
+            m_backwards++;
+            continue;
+        }
+        uint64_t dt = timestamps_ns[i] - timestamps_ns[i-1];
+        m_intervals.record(dt);
+        sum += dt;
+        sq_sum += double(dt) * dt;
+    }
+    uint64_t n = m_intervals.count();
+    if (n == 0) return;
+    double mean = sum / n;
+    m_jitter_ns = sqrt(max(0.0, sq_sum / n - mean * mean));
+    m_span_s = (timestamps_ns.back() - timestamps_ns.front()) / 1e9;
+    if (m_span_s > 0.0) m_rate_hz = (m_frames - 1) / m_span_s;
+
+    /* Second pass: the gaps, relative to the typical interval */
+    uint64_t median = m_intervals.percentile(50.0);
+    if (median == 0) return;
+    for (size_t i = 1; i < timestamps_ns.size(); i++) {
+        if (timestamps_ns[i] < timestamps_ns[i-1]) continue;
+        uint64_t dt = timestamps_ns[i] - timestamps_ns[i-1];
+        if (dt <= m_gap_factor * median) continue;
+        m_gaps++;
+        m_missed_slots += static_cast<uint64_t>(double(dt) / median + 0.5) - 1;
+        if (dt > m_longest_gap_ns) {
+            m_longest_gap_ns = dt;
+            m_longest_gap_frame = i;
+        }
+    }
+}
+
+void FrameTimeline::print(ostream& os) const
+{
+    os << " Frame timeline: " << m_frames << " frames";
+    if (m_intervals.count() == 0) {
+        os << endl;
+        return;
+    }
+    os << fixed << setprecision(3)
+       << " over " << m_span_s << "s, " << setprecision(1) << m_rate_hz << " Hz" << endl;
+    LatencyHistogram::print_header(os);
+    m_intervals.print(os, "frame interval:");
+    os << setprecision(1)
+       << " Interval jitter: " << m_jitter_ns / 1000. << "us stddev, "
+       << (m_intervals.percentile(99.0) - m_intervals.percentile(50.0)) / 1000.
+       << "us p99-p50" << endl
+       << " Gaps (> " << m_gap_factor << "x median interval): " << m_gaps;
+    if (m_gaps > 0) {
+        os << ", ~" << m_missed_slots << " frame periods lost, longest "
+           << setprecision(3) << m_longest_gap_ns / 1e6 << "ms before frame "
+           << m_longest_gap_frame;
+    }
+    os << endl;
+    if (m_backwards > 0) {
+        os << " Timestamps out of order: " << m_backwards << endl;
+    }
+}
@@ -0,0 +1,46 @@
+/*
+ * frametimeline.h
+ *
+ * Post-mortem timeline of an acquisition. The writer appends the
+ * CLOCK_MONOTONIC time at which each frame was written to a 1D uint64
+ * dataset which grows in lockstep with the image dataset. With direct
+ * chunk writes frames are written a slab at a time, so the time is when
+ * the frame was packed into the slab instead. The reader
+ * analyses the timestamps: the observed frame rate, the distribution of
+ * the intervals between frames, their jitter and the gaps, i.e. intervals
+ * well above the typical (median) interval.
+ */
+
+#ifndef FRAMETIMELINE_H_
+#define FRAMETIMELINE_H_
+
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+
+#include "histogram.h"
+
+#define FRAME_TIMESTAMPS_DSET "timestamps"
+
+class FrameTimeline {
+public:
+    FrameTimeline(double gap_factor = 2.0);
+    void analyse(const std::vector<uint64_t>& timestamps_ns);
+    void print(std::ostream& os) const;
+    uint64_t frames() const { return m_frames; }
+
+private:
+    double m_gap_factor;          // gap: interval > gap_factor * median
+    uint64_t m_frames;
+    double m_span_s;
+    double m_rate_hz;
+    double m_jitter_ns;           // standard deviation of the intervals
+    uint64_t m_backwards;         // timestamps earlier than the previous one
+    uint64_t m_gaps;
+    uint64_t m_missed_slots;      // frame periods lost in the gaps
+    uint64_t m_longest_gap_ns;
+    uint64_t m_longest_gap_frame; // the frame after the longest gap
+    LatencyHistogram m_intervals;
+};
+
+#endif /* FRAMETIMELINE_H_ */
@@ -0,0 +1,121 @@
+#include <iomanip>
+#include <algorithm>
+
+#include "histogram.h"
+
+using namespace std;
+
+// Number of bits resolved linearly within each power-of-two range.
+// Values below 2^SUB_BITS ns are recorded exactly.
+static const unsigned int SUB_BITS = 7;
+static const uint64_t SUB_COUNT = 1ULL << SUB_BITS;
+static const uint64_t HALF_COUNT = SUB_COUNT / 2;
+static const size_t NUM_BUCKETS = (66 - SUB_BITS) * HALF_COUNT;
+
+LatencyHistogram::LatencyHistogram()
+{
+    this->reset();
+}
+
+void LatencyHistogram::reset()
+{
+    m_buckets.assign(NUM_BUCKETS, 0);
+    m_count = 0;
+    m_min = 0;
+    m_max = 0;
+    m_sum = 0.0;
+}
+
+size_t LatencyHistogram::bucket_index(uint64_t value)
+{
+    if (value < SUB_COUNT) return static_cast<size_t>(value);
+    unsigned int msb = 63 - __builtin_clzll(value);
+    unsigned int shift = msb - SUB_BITS + 1;
+    uint64_t sub = value >> shift; // in the range [HALF_COUNT, SUB_COUNT)
+    return static_cast<size_t>((shift + 1) * HALF_COUNT + (sub - HALF_COUNT));
+}
+
+uint64_t LatencyHistogram::bucket_upper(size_t index)
+{
+    if (index < SUB_COUNT) return index;
+    unsigned int shift = static_cast<unsigned int>(index / HALF_COUNT) - 1;
+    uint64_t sub = index % HALF_COUNT + HALF_COUNT;
+    return (sub << shift) + ((1ULL << shift) - 1);
+}
+
+void LatencyHistogram::record(uint64_t value_ns)
+{
+    m_buckets[bucket_index(value_ns)]++;
+    if (m_count == 0 || value_ns < m_min) m_min = value_ns;
+    if (value_ns > m_max) m_max = value_ns;
+    m_sum += value_ns;
+    m_count++;
+}
+
+void LatencyHistogram::add(const LatencyHistogram& other)
+{
+    if (other.m_count == 0) return;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) m_buckets[i] += other.m_buckets[i];
+    if (m_count == 0 || other.m_min < m_min) m_min = other.m_min;
+    if (other.m_max > m_max) m_max = other.m_max;
+    m_sum += other.m_sum;
+    m_count += other.m_count;
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+uint64_t LatencyHistogram::min() const
+{
+    return m_min;
+}
+
+uint64_t LatencyHistogram::max() const
+{
+    return m_max;
+}
+
+double LatencyHistogram::mean() const
+{
+    if (m_count == 0) return 0.0;
+    return m_sum / m_count;
+}
+
+uint64_t LatencyHistogram::percentile(double pct) const
+{
+    if (m_count == 0) return 0;
+    uint64_t target = static_cast<uint64_t>(pct / 100.0 * m_count + 0.5);
+    if (target < 1) target = 1;
+    if (target > m_count) target = m_count;
+
+    uint64_t cumulative = 0;
+    for (size_t i = 0; i < NUM_BUCKETS; i++) {
+        cumulative += m_buckets[i];
+        if (cumulative >= target) {
+            // Report the highest value equivalent to this bucket, but never
+            // beyond what was actually recorded.
+            return std::min(std::max(bucket_upper(i), m_min), m_max);
+        }
+    }
+    return m_max;
+}
+
+void LatencyHistogram::print_header(ostream& os)
+{
+    os << setw(18) << "[us]" << setw(10) << "count"
+       << setw(10) << "p50" << setw(10) << "p90" << setw(10) << "p99"
+       << setw(10) << "p99.9" << setw(10) << "max" << endl;
+}
+
+void LatencyHistogram::print(ostream& os, const string& name) const
+{
+    os << setw(18) << name << setw(10) << m_count
+       << fixed << setprecision(1)
+       << setw(10) << this->percentile(50.0) / 1000.
+       << setw(10) << this->percentile(90.0) / 1000.
+       << setw(10) << this->percentile(99.0) / 1000.
+       << setw(10) << this->percentile(99.9) / 1000.
+       << setw(10) << m_max / 1000. << endl;
+}
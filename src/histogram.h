@@ -0,0 +1,46 @@
+/*
+ * histogram.h
+ *
+ * Log-linear (HDR-style) latency histogram. Values are recorded as integer
+ * nanoseconds into buckets which are linear within each power-of-two range,
+ * giving a fixed relative precision (~1.6%) over the full 64-bit range with
+ * constant time recording and no allocation after construction.
+ */
+
+#ifndef HISTOGRAM_H_
+#define HISTOGRAM_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+
+class LatencyHistogram {
+public:
+    LatencyHistogram();
+    ~LatencyHistogram(){};
+    void reset();
+    void record(uint64_t value_ns);
+    void add(const LatencyHistogram& other);
+
+    uint64_t count() const;
+    uint64_t min() const;
+    uint64_t max() const;
+    double mean() const;
+    uint64_t percentile(double pct) const;
+
+    static void print_header(std::ostream& os);
+    void print(std::ostream& os, const std::string& name) const;
+
+private:
+    static size_t bucket_index(uint64_t value);
+    static uint64_t bucket_upper(size_t index);
+
+    std::vector<uint64_t> m_buckets;
+    uint64_t m_count;
+    uint64_t m_min;
+    uint64_t m_max;
+    double m_sum;
+};
+
+#endif /* HISTOGRAM_H_ */
@@ -0,0 +1,170 @@
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "timestamp.h"
+#include "livestats.h"
+
+using namespace std;
+
+// Minimum time between two rate calculations
+static const uint64_t RATE_WINDOW_NS = 200000000ULL;
+
+// Longest a monitor waits for the publisher to finish an update
+static const uint64_t SNAPSHOT_TIMEOUT_NS = 1000000000ULL;
+
+LiveStats::LiveStats()
+: m_data(NULL), m_owner(false), m_window_ns(0), m_window_frames(0)
+{
+}
+
+LiveStats::~LiveStats()
+{
+    if (m_owner) this->finish();
+    this->unmap();
+    if (m_owner) shm_unlink(m_name.c_str());
+}
+
+string LiveStats::segment_name(const string& name)
+{
+    if (name.empty() || name[0] != '/') return "/" + name;
+    return name;
+}
+
+void LiveStats::publish(const string& name, const string& role)
+{
+    m_name = LiveStats::segment_name(name);
+    int fd = shm_open(m_name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        throw runtime_error("Unable to create shared memory " + m_name
+                            + ": " + strerror(errno));
+    }
+    if (ftruncate(fd, sizeof(LiveStatsData)) < 0) {
+        close(fd);
+        throw runtime_error("Unable to size shared memory " + m_name
+                            + ": " + strerror(errno));
+    }
+    void * addr = mmap(NULL, sizeof(LiveStatsData), PROT_READ | PROT_WRITE,
+                       MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        throw runtime_error("Unable to map shared memory " + m_name
+                            + ": " + strerror(errno));
+    }
+    m_data = static_cast<LiveStatsData *>(addr);
+    m_owner = true;
+
+    memset(m_data, 0, sizeof(LiveStatsData));
+    strncpy(m_data->role, role.c_str(), sizeof(m_data->role) - 1);
+    m_data->pid = getpid();
+    m_data->start_ns = TimeStamp::monotonic_now_ns();
+    m_data->update_ns = m_data->start_ns;
+    m_data->version = LIVESTATS_VERSION;
+    m_data->state = LiveStatsData::running;
+    __sync_synchronize();
+    m_data->magic = LIVESTATS_MAGIC;
+
+    m_window_ns = m_data->start_ns;
+    m_window_frames = 0;
+}
+
+bool LiveStats::enabled() const
+{
+    return m_owner && m_data != NULL;
+}
+
+void LiveStats::update(uint64_t frames, uint64_t last_latency_ns,
+                       uint64_t failures)
+{
+    if (!this->enabled()) return;
+    uint64_t now = TimeStamp::monotonic_now_ns();
+
+    m_data->seq++;
+    __sync_synchronize();
+    m_data->update_ns = now;
+    m_data->frames = frames;
+    m_data->failures = failures;
+    m_data->last_latency_ns = last_latency_ns;
+    if (now - m_window_ns >= RATE_WINDOW_NS) {
+        m_data->rate = (frames - m_window_frames) * 1E9 / (now - m_window_ns);
+        m_window_ns = now;
+        m_window_frames = frames;
+    }
+    __sync_synchronize();
+    m_data->seq++;
+}
+
+void LiveStats::finish()
+{
+    if (!this->enabled()) return;
+    m_data->seq++;
+    __sync_synchronize();
+    m_data->state = LiveStatsData::finished;
+    m_data->update_ns = TimeStamp::monotonic_now_ns();
+    __sync_synchronize();
+    m_data->seq++;
+}
+
+void LiveStats::attach(const string& name)
+{
+    m_name = LiveStats::segment_name(name);
+    int fd = shm_open(m_name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        throw runtime_error("Unable to open shared memory " + m_name
+                            + ": " + strerror(errno));
+    }
+    void * addr = mmap(NULL, sizeof(LiveStatsData), PROT_READ,
+                       MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        throw runtime_error("Unable to map shared memory " + m_name
+                            + ": " + strerror(errno));
+    }
+    m_data = static_cast<LiveStatsData *>(addr);
+    m_owner = false;
+    if (m_data->magic != LIVESTATS_MAGIC || m_data->version != LIVESTATS_VERSION) {
+        this->unmap();
+        throw runtime_error("Not a swmr live statistics segment: " + m_name);
+    }
+}
+
+bool LiveStats::snapshot(LiveStatsData& out) const
+{
+    if (m_data == NULL) {
+        throw runtime_error("Live statistics segment not attached");
+    }
+    /* A publisher which dies, or is stopped, mid-update leaves the sequence
+     * number odd: give up after a while, or as soon as it is gone */
+    uint64_t start = TimeStamp::monotonic_now_ns();
+    uint32_t seq0, seq1;
+    for (unsigned long spins = 0;; spins++) {
+        seq0 = m_data->seq;
+        __sync_synchronize();
+        memcpy(&out, m_data, sizeof(LiveStatsData));
+        __sync_synchronize();
+        seq1 = m_data->seq;
+        if (!(seq0 & 1) && seq0 == seq1) return true;
+
+        if (spins % 1024 == 1023) {
+            bool alive = kill(out.pid, 0) == 0 || errno == EPERM;
+            if (!alive || TimeStamp::monotonic_now_ns() - start >= SNAPSHOT_TIMEOUT_NS) {
+                return false;
+            }
+        }
+        sched_yield();
+    }
+}
+
+void LiveStats::unmap()
+{
+    if (m_data != NULL) {
+        munmap(m_data, sizeof(LiveStatsData));
+        m_data = NULL;
+    }
+}
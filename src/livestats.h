@@ -0,0 +1,70 @@
+/*
+ * livestats.h
+ *
+ * Live statistics published by a running writer or reader into a POSIX
+ * shared memory segment, for external monitors such as "swmr stat".
+ *
+ * The publisher updates the counters with a seqlock: the sequence number is
+ * odd while an update is in progress, so readers never block the publisher
+ * and simply retry if they observe a torn update. A publisher which dies
+ * mid-update leaves the sequence number odd, so readers give up after a
+ * bounded wait rather than spinning forever.
+ */
+
+#ifndef LIVESTATS_H_
+#define LIVESTATS_H_
+
+#include <string>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define LIVESTATS_MAGIC   0x53574d52 /* "SWMR" */
+#define LIVESTATS_VERSION 1
+
+struct LiveStatsData {
+    enum { starting = 0, running = 1, finished = 2 };
+
+    uint32_t magic;
+    uint32_t version;
+    volatile uint32_t seq;
+    uint32_t state;
+    char role[16];
+    pid_t pid;
+    uint64_t start_ns;       // TimeStamp::monotonic_now_ns(), shared between processes
+    uint64_t update_ns;
+    uint64_t frames;         // frames written or read
+    uint64_t failures;       // failed checks (reader)
+    uint64_t last_latency_ns; // last flush (writer) or read (reader) latency
+    double rate;             // frames per second over the last window
+};
+
+class LiveStats {
+public:
+    LiveStats();
+    ~LiveStats();
+
+    // Publisher side
+    void publish(const std::string& name, const std::string& role);
+    bool enabled() const;
+    void update(uint64_t frames, uint64_t last_latency_ns, uint64_t failures);
+    void finish();
+
+    // Monitor side
+    void attach(const std::string& name);
+    bool snapshot(LiveStatsData& out) const;   // false: torn, publisher stuck or gone
+
+    static std::string segment_name(const std::string& name);
+
+private:
+    LiveStats(const LiveStats&);            // not copyable
+    LiveStats& operator=(const LiveStats&);
+    void unmap();
+
+    std::string m_name;
+    LiveStatsData * m_data;
+    bool m_owner;
+    uint64_t m_window_ns;
+    uint64_t m_window_frames;
+};
+
+#endif /* LIVESTATS_H_ */
@@ -0,0 +1,151 @@
+#include <vector>
+#include <iomanip>
+#include <algorithm>
+#include <cstdlib>
+
+#include "mdclog.h"
+
+using namespace std;
+
+// Maximum number of spikes listed
+static const size_t MAX_SPIKES = 20;
+
+/* Value of a JSON field "name":value, or "" if the line has no such field */
+static string json_field(const string& line, const string& name)
+{
+    string key = "\"" + name + "\":";
+    size_t pos = line.find(key);
+    if (pos == string::npos) return "";
+    pos += key.size();
+    if (pos < line.size() && line[pos] == '"') {
+        size_t end = line.find('"', pos + 1);
+        if (end == string::npos) return "";
+        return line.substr(pos + 1, end - pos - 1);
+    }
+    size_t end = line.find_first_of(",}", pos);
+    return line.substr(pos, end == string::npos ? string::npos : end - pos);
+}
+
+MdcLogSummary::MdcLogSummary()
+: m_messages(0)
+{
+}
+
+/* Entry type ids (H5AC_*_ID) of the HDF5 1.10 metadata cache */
+const char * MdcLogSummary::type_name(int type_id)
+{
+    static const char * names[] = {
+        "v1 B-tree node", "symbol table node", "local heap prefix",
+        "local heap data", "global heap", "object header",
+        "object header chunk", "v2 B-tree header", "v2 B-tree internal",
+        "v2 B-tree leaf", "fractal heap header", "fractal heap direct",
+        "fractal heap indirect", "free-space header", "free-space sections",
+        "SOHM table", "SOHM list", "earray header", "earray index block",
+        "earray super block", "earray data block", "earray data page",
+        "farray header", "farray data block", "farray data page",
+        "superblock", "driver info", "epoch marker", "proxy entry"
+    };
+    if (type_id < 0 || type_id >= int(sizeof(names) / sizeof(names[0]))) return "unknown";
+    return names[type_id];
+}
+
+void MdcLogSummary::parse(istream& is)
+{
+    string line;
+    while (getline(is, line)) this->parse_line(line);
+}
+
+void MdcLogSummary::parse_line(const string& line)
+{
+    string action;
+    long long timestamp = -1;
+    if (line.find("\"action\":") != string::npos) {
+        action = json_field(line, "action");
+        string ts = json_field(line, "timestamp");
+        if (!ts.empty()) timestamp = atoll(ts.c_str());
+        string size = json_field(line, "size");
+        string type = json_field(line, "type_id");
+        if (!size.empty() && !type.empty()) {
+            SizeStats& s = m_sizes[atoi(type.c_str())];
+            uint64_t nbytes = strtoull(size.c_str(), NULL, 0);
+            s.count++;
+            s.bytes += nbytes;
+            s.max = max(s.max, nbytes);
+        }
+    } else {
+        /* Other log styles: the first word is the action */
+        size_t start = line.find_first_not_of(" \t");
+        if (start == string::npos || line[start] == '{' || line[start] == '[' ||
+            line[start] == ']' || line[start] == '"') return;
+        action = line.substr(start, line.find_first_of(" \t(:", start) - start);
+        if (action.compare(0, 5, "H5AC_") == 0) action = action.substr(5);
+        else if (action.compare(0, 4, "H5C_") == 0) action = action.substr(4);
+    }
+    if (action.empty()) return;
+    m_messages++;
+    m_actions[action]++;
+    if (timestamp >= 0) m_timeline[timestamp][action]++;
+}
+
+void MdcLogSummary::print(ostream& os, unsigned long long nframes, double spike_factor) const
+{
+    os << " Metadata cache log messages: " << m_messages;
+    if (!m_timeline.empty()) {
+        os << " over " << m_timeline.rbegin()->first - m_timeline.begin()->first + 1 << "s";
+    }
+    os << endl << endl
+       << setw(24) << "[action]" << setw(12) << "count";
+    if (nframes > 0) os << setw(12) << "per frame";
+    os << endl;
+    for (map<string, uint64_t>::const_iterator it = m_actions.begin();
+         it != m_actions.end(); ++it) {
+        os << setw(24) << it->first + ":" << setw(12) << it->second;
+        if (nframes > 0) {
+            os << setw(12) << fixed << setprecision(2) << double(it->second) / nframes;
+        }
+        os << endl;
+    }
+
+    if (!m_sizes.empty()) {
+        os << endl << setw(24) << "[entry type]" << setw(12) << "accesses"
+           << setw(12) << "KBytes" << setw(10) << "mean[B]" << setw(10) << "max[B]" << endl;
+        for (map<int, SizeStats>::const_iterator it = m_sizes.begin();
+             it != m_sizes.end(); ++it) {
+            const SizeStats& s = it->second;
+            os << setw(24) << string(type_name(it->first)) + ":" << setw(12) << s.count
+               << setw(12) << fixed << setprecision(1) << s.bytes / 1024.
+               << setw(10) << setprecision(0) << double(s.bytes) / s.count
+               << setw(10) << s.max << endl;
+        }
+    }
+
+    if (m_timeline.size() < 2) return;
+    /* Seconds with spike_factor times the median number of messages */
+    vector<uint64_t> per_second;
+    map<long long, map<string, uint64_t> >::const_iterator sec;
+    for (sec = m_timeline.begin(); sec != m_timeline.end(); ++sec) {
+        uint64_t n = 0;
+        map<string, uint64_t>::const_iterator a;
+        for (a = sec->second.begin(); a != sec->second.end(); ++a) n += a->second;
+        per_second.push_back(n);
+    }
+    vector<uint64_t> sorted(per_second);
+    nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+    uint64_t median = sorted[sorted.size() / 2];
+    os << endl << " Messages per second: median " << median
+       << ", spikes above " << fixed << setprecision(1) << spike_factor << "x:" << endl;
+    size_t nspikes = 0, i = 0;
+    long long t0 = m_timeline.begin()->first;
+    for (sec = m_timeline.begin(); sec != m_timeline.end(); ++sec, ++i) {
+        if (per_second[i] <= spike_factor * median) continue;
+        if (++nspikes > MAX_SPIKES) continue;
+        os << "  +" << setw(6) << sec->first - t0 << "s: " << setw(8) << per_second[i];
+        map<string, uint64_t>::const_iterator a;
+        for (a = sec->second.begin(); a != sec->second.end(); ++a) {
+            os << "  " << a->first << "=" << a->second;
+        }
+        os << endl;
+    }
+    if (nspikes == 0) os << "  none" << endl;
+    if (nspikes > MAX_SPIKES) os << "  ... " << nspikes - MAX_SPIKES << " more" << endl;
+}
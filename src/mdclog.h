@@ -0,0 +1,49 @@
+/*
+ * mdclog.h
+ *
+ * Offline summary of an HDF5 metadata cache log, as written by the library
+ * when logging is enabled with H5Pset_mdc_log_options().
+ *
+ * Each log message is reduced to its action (protect, insert, dirty, flush,
+ * evict, ...), the cache entry type, the entry size and the timestamp, when
+ * the message has them. Messages are counted per action and, given the
+ * number of frames written or read, per frame. Entry sizes are summarised
+ * per entry type, and the seconds in which the number of messages spikes
+ * are listed, to line them up with latency spikes in the reports.
+ *
+ * The JSON style log of HDF5 1.10 is parsed field by field. Other styles
+ * are reduced to their first word as the action.
+ */
+
+#ifndef MDCLOG_H_
+#define MDCLOG_H_
+
+#include <string>
+#include <map>
+#include <istream>
+#include <ostream>
+#include <stdint.h>
+
+class MdcLogSummary {
+public:
+    MdcLogSummary();
+    void parse(std::istream& is);
+    void print(std::ostream& os, unsigned long long nframes, double spike_factor) const;
+
+private:
+    struct SizeStats {
+        uint64_t count;
+        uint64_t bytes;
+        uint64_t max;
+    };
+
+    void parse_line(const std::string& line);
+    static const char * type_name(int type_id);
+
+    uint64_t m_messages;
+    std::map<std::string, uint64_t> m_actions;
+    std::map<int, SizeStats> m_sizes;                  // by entry type
+    std::map<long long, std::map<std::string, uint64_t> > m_timeline; // by second
+};
+
+#endif /* MDCLOG_H_ */
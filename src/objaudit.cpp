@@ -0,0 +1,73 @@
+#include <sstream>
+#include <stdexcept>
+#include <assert.h>
+
+#include <log4cxx/logger.h>
+using namespace log4cxx;
+
+#include "objaudit.h"
+
+using namespace std;
+
+ObjectAudit::ObjectAudit(unsigned int interval)
+: m_log(Logger::getLogger("ObjectAudit")), m_fid(-1), m_interval(interval),
+  m_ticks(0)
+{
+    assert(interval > 0);
+    for (int i = 0; i < ncounts; i++) m_baseline[i] = 0;
+}
+
+const char * ObjectAudit::count_name(int index)
+{
+    switch (index) {
+    case datasets:   return "datasets";
+    case groups:     return "groups";
+    case datatypes:  return "datatypes";
+    case attributes: return "attributes";
+    case files:      return "files";
+    default:         return "unknown";
+    }
+}
+
+void ObjectAudit::count(hsize_t counts[ncounts]) const
+{
+    static const unsigned int types[ncounts] = {
+        H5F_OBJ_DATASET, H5F_OBJ_GROUP, H5F_OBJ_DATATYPE, H5F_OBJ_ATTR, H5F_OBJ_FILE
+    };
+    for (int i = 0; i < ncounts; i++) {
+        ssize_t n = H5Fget_obj_count(m_fid, types[i] | H5F_OBJ_LOCAL);
+        assert(n >= 0);
+        counts[i] = n;
+    }
+}
+
+void ObjectAudit::baseline(hid_t fid)
+{
+    m_fid = fid;
+    m_ticks = 0;
+    this->count(m_baseline);
+}
+
+void ObjectAudit::tick(const string& where)
+{
+    if (++m_ticks % m_interval == 0) this->check(where);
+}
+
+void ObjectAudit::check(const string& where)
+{
+    assert(m_fid >= 0);
+    hsize_t counts[ncounts];
+    this->count(counts);
+    ostringstream leaks;
+    for (int i = 0; i < ncounts; i++) {
+        if (counts[i] > m_baseline[i]) {
+            leaks << " " << count_name(i) << ": " << m_baseline[i]
+                  << " -> " << counts[i];
+        }
+    }
+    if (!leaks.str().empty()) {
+        LOG4CXX_ERROR(m_log, "Open HDF5 objects leaked (" << where << "):" << leaks.str());
+        throw logic_error("HDF5 object leak (" + where + "):" + leaks.str());
+    }
+    LOG4CXX_DEBUG(m_log, "No HDF5 object leaks (" << where << ")");
+}
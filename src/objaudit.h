@@ -0,0 +1,43 @@
+/*
+ * objaudit.h
+ *
+ * Audit of open HDF5 objects, to catch identifier leaks.
+ *
+ * A baseline of the number of open objects in the file (datasets, groups,
+ * datatypes, attributes, files) is taken once the steady state is reached.
+ * Later checks throw if any count has grown. Dataspaces and property lists
+ * are not file objects and the library does not count them for
+ * applications (H5Inmembers rejects library types), so they are not
+ * audited. Checks walk the library's identifier
+ * tables, so they are kept out of the per-frame path: tick() only checks
+ * every 'interval' calls.
+ */
+
+#ifndef OBJAUDIT_H_
+#define OBJAUDIT_H_
+
+#include <string>
+#include <hdf5.h>
+#include <log4cxx/logger.h>
+
+class ObjectAudit {
+public:
+    enum { datasets = 0, groups, datatypes, attributes, files, ncounts };
+
+    ObjectAudit(unsigned int interval = 1000);
+    void baseline(hid_t fid);
+    void tick(const std::string& where);
+    void check(const std::string& where);
+
+private:
+    void count(hsize_t counts[ncounts]) const;
+    static const char * count_name(int index);
+
+    LoggerPtr m_log;
+    hid_t m_fid;
+    unsigned int m_interval;
+    unsigned long long m_ticks;
+    hsize_t m_baseline[ncounts];
+};
+
+#endif /* OBJAUDIT_H_ */
@@ -0,0 +1,96 @@
+#include <iomanip>
+#include <ctime>
+#include <cerrno>
+
+#include "timestamp.h"
+#include "pacer.h"
+
+using namespace std;
+
+// Wake up this long before the deadline and spin for the remainder. This
+// needs to cover the default 50us timer slack plus the wakeup latency.
+static const uint64_t SPIN_NS = 100000;
+
+FramePacer::FramePacer()
+: m_rate(0.0), m_burst_frames(0), m_period_ns(0), m_burst_period_ns(0),
+  m_start_ns(0), m_last_ns(0), m_frames(0), m_missed(0)
+{
+}
+
+void FramePacer::configure(double rate_hz, unsigned int burst_frames,
+                           double burst_period)
+{
+    m_rate = rate_hz;
+    m_period_ns = rate_hz > 0.0 ? static_cast<uint64_t>(1E9 / rate_hz) : 0;
+    m_burst_frames = burst_frames;
+    m_burst_period_ns = static_cast<uint64_t>(burst_period * 1E9);
+}
+
+bool FramePacer::enabled() const
+{
+    return m_period_ns > 0;
+}
+
+void FramePacer::start()
+{
+    m_start_ns = TimeStamp::monotonic_now_ns();
+    m_last_ns = m_start_ns;
+    m_frames = 0;
+    m_missed = 0;
+    m_jitter.reset();
+}
+
+uint64_t FramePacer::deadline(unsigned long long frame) const
+{
+    if (m_burst_frames > 0) {
+        unsigned long long burst = frame / m_burst_frames;
+        unsigned long long index = frame % m_burst_frames;
+        return m_start_ns + burst * m_burst_period_ns + index * m_period_ns;
+    }
+    return m_start_ns + frame * m_period_ns;
+}
+
+void FramePacer::wait(unsigned long long frame)
+{
+    if (!this->enabled()) return;
+    uint64_t target = this->deadline(frame);
+    uint64_t now = TimeStamp::monotonic_now_ns();
+
+    if (now > target) {
+        // Still busy with earlier frames when this one was due
+        m_missed++;
+    } else {
+        if (target - now > SPIN_NS) {
+            uint64_t wake = target - SPIN_NS;
+            timespec ts;
+            ts.tv_sec = wake / 1000000000ULL;
+            ts.tv_nsec = wake % 1000000000ULL;
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) ;
+        }
+        while ((now = TimeStamp::monotonic_now_ns()) < target) ;
+    }
+    m_jitter.record(now - target);
+    m_last_ns = now;
+    m_frames++;
+}
+
+void FramePacer::print(ostream& os) const
+{
+    if (!this->enabled()) return;
+    double elapsed = (m_last_ns - m_start_ns) / 1E9;
+    os << fixed << setprecision(1)
+       << " Target frame rate:   " << m_rate << "Hz";
+    if (m_burst_frames > 0) {
+        os << " (bursts of " << m_burst_frames << " frames every "
+           << setprecision(3) << m_burst_period_ns / 1E9 << "s)";
+    }
+    os << endl << setprecision(1);
+    if (m_frames > 1 && elapsed > 0.) {
+        os << " Achieved frame rate: " << (m_frames - 1) / elapsed << "Hz" << endl;
+    }
+    os << " Missed deadlines:    " << m_missed << " of " << m_frames << endl
+       << endl;
+    LatencyHistogram::print_header(os);
+    m_jitter.print(os, "release jitter:");
+    os << endl;
+}
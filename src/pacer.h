@@ -0,0 +1,48 @@
+/*
+ * pacer.h
+ *
+ * Deadline based frame pacing, to emulate the frame rate of a detector.
+ *
+ * Frame i is released at an absolute deadline computed from the start time,
+ * so that delays never accumulate. The pacer sleeps with clock_nanosleep()
+ * on an absolute CLOCK_MONOTONIC time until shortly before the deadline and
+ * then spins for the remainder, to avoid the scheduler wakeup latency.
+ *
+ * In burst mode, bursts of N frames at the given rate are started at a fixed
+ * burst period.
+ */
+
+#ifndef PACER_H_
+#define PACER_H_
+
+#include <ostream>
+#include <stdint.h>
+
+#include "histogram.h"
+
+class FramePacer {
+public:
+    FramePacer();
+    ~FramePacer(){};
+    void configure(double rate_hz, unsigned int burst_frames = 0,
+                   double burst_period = 0.0);
+    bool enabled() const;
+    void start();
+    void wait(unsigned long long frame);
+    void print(std::ostream& os) const;
+
+private:
+    uint64_t deadline(unsigned long long frame) const;
+
+    double m_rate;
+    unsigned int m_burst_frames;
+    uint64_t m_period_ns;
+    uint64_t m_burst_period_ns;
+    uint64_t m_start_ns;
+    uint64_t m_last_ns;
+    unsigned long long m_frames;
+    unsigned long long m_missed;
+    LatencyHistogram m_jitter;
+};
+
+#endif /* PACER_H_ */
@@ -0,0 +1,205 @@
+#include <cstdlib>
+#include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <stdexcept>
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <log4cxx/logger.h>
+using namespace log4cxx;
+
+#include "placement.h"
+
+using namespace std;
+
+/* From linux/mempolicy.h: called through syscall() so that the build does
+ * not depend on libnuma */
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+#ifndef MPOL_F_NODE
+#define MPOL_F_NODE (1 << 0)
+#define MPOL_F_ADDR (1 << 1)
+#endif
+
+struct ThreadPlacement {
+    string role;
+    string allowed;      // CPUs the thread may run on
+    int cpu;             // where it was running once pinned
+};
+
+struct BufferPlacement {
+    string name;
+    const void * addr;
+};
+
+static LoggerPtr g_log(Logger::getLogger("CpuPlacement"));
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool g_enabled = false;
+static string g_cpu_list;
+static vector<int> g_cpus;
+static int g_node = -1;
+static vector<ThreadPlacement> g_threads;
+static vector<BufferPlacement> g_buffers;
+
+/* Parse a Linux CPU list, e.g. "0-3,8,10-11" */
+static vector<int> parse_cpu_list(const string& list)
+{
+    vector<int> cpus;
+    stringstream ss(list);
+    string range;
+    while (getline(ss, range, ',')) {
+        if (range.empty()) continue;
+        int first = -1, last = -1;
+        char dash = 0;
+        istringstream rs(range);
+        rs >> first;
+        if (rs >> dash) {
+            if (dash != '-' || !(rs >> last)) first = -1;
+        } else {
+            last = first;
+        }
+        if (first < 0 || last < first || !rs.eof()) {
+            throw logic_error("Invalid CPU list: " + list);
+        }
+        for (int c = first; c <= last; c++) cpus.push_back(c);
+    }
+    if (cpus.empty()) throw logic_error("Invalid CPU list: " + list);
+    return cpus;
+}
+
+static string cpus_to_string(const vector<int>& cpus)
+{
+    ostringstream oss;
+    for (size_t c = 0; c < cpus.size(); c++) oss << (c ? "," : "") << cpus[c];
+    return oss.str();
+}
+
+void CpuPlacement::configure(const string& cpu_list, int numa_node)
+{
+    g_cpu_list = cpu_list;
+    g_node = numa_node;
+    g_cpus.clear();
+    if (numa_node >= 0) {
+        ostringstream path;
+        path << "/sys/devices/system/node/node" << numa_node << "/cpulist";
+        ifstream is(path.str().c_str());
+        string node_cpus;
+        if (!is || !getline(is, node_cpus)) {
+            ostringstream msg;
+            msg << "No such NUMA node: " << numa_node;
+            throw runtime_error(msg.str());
+        }
+        g_cpus = parse_cpu_list(node_cpus);
+
+        /* Later allocations (and first touches) on the node */
+        unsigned long nodemask[16] = { 0 };
+        assert(numa_node < int(sizeof(nodemask) * 8));
+        nodemask[numa_node / (8 * sizeof(unsigned long))] |=
+                1UL << (numa_node % (8 * sizeof(unsigned long)));
+        if (syscall(SYS_set_mempolicy, MPOL_PREFERRED, nodemask,
+                    sizeof(nodemask) * 8) != 0) {
+            LOG4CXX_WARN(g_log, "set_mempolicy failed (errno " << errno
+                         << "): memory is not bound to node " << numa_node);
+        }
+    }
+    if (!cpu_list.empty()) {
+        vector<int> cpus = parse_cpu_list(cpu_list);
+        if (numa_node >= 0) {
+            for (size_t c = 0; c < cpus.size(); c++) {
+                if (find(g_cpus.begin(), g_cpus.end(), cpus[c]) == g_cpus.end()) {
+                    LOG4CXX_WARN(g_log, "CPU " << cpus[c] << " is not on NUMA node " << numa_node);
+                }
+            }
+        }
+        g_cpus = cpus;
+    }
+    g_enabled = !g_cpus.empty();
+}
+
+bool CpuPlacement::enabled()
+{
+    return g_enabled;
+}
+
+void CpuPlacement::pin_thread(const string& role, unsigned int index)
+{
+    if (!g_enabled) return;
+
+    /* A CPU per thread from a CPU list, or any CPU of the node */
+    vector<int> allowed;
+    if (!g_cpu_list.empty()) {
+        allowed.push_back(g_cpus[index % g_cpus.size()]);
+    } else {
+        allowed = g_cpus;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t c = 0; c < allowed.size(); c++) CPU_SET(allowed[c], &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        LOG4CXX_WARN(g_log, "Unable to pin " << role << " to CPU(s) "
+                     << cpus_to_string(allowed) << " (errno " << err << ")");
+    }
+
+    ThreadPlacement placement;
+    placement.role = role;
+    if (index > 0) {
+        ostringstream name;
+        name << role << " " << index;
+        placement.role = name.str();
+    }
+    placement.allowed = err == 0 ? cpus_to_string(allowed) : "not pinned";
+    placement.cpu = sched_getcpu();
+    LOG4CXX_DEBUG(g_log, "Pinned " << role << " to CPU(s) " << placement.allowed);
+    pthread_mutex_lock(&g_lock);
+    g_threads.push_back(placement);
+    pthread_mutex_unlock(&g_lock);
+}
+
+void CpuPlacement::note_buffer(const string& name, const void * addr)
+{
+    if (!g_enabled || addr == NULL) return;
+    BufferPlacement buffer;
+    buffer.name = name;
+    buffer.addr = addr;
+    pthread_mutex_lock(&g_lock);
+    g_buffers.push_back(buffer);
+    pthread_mutex_unlock(&g_lock);
+}
+
+int CpuPlacement::node_of_address(const void * addr)
+{
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, NULL, 0, addr,
+                MPOL_F_NODE | MPOL_F_ADDR) != 0) return -1;
+    return node;
+}
+
+void CpuPlacement::print(ostream& os)
+{
+    if (!g_enabled) return;
+    pthread_mutex_lock(&g_lock);
+    os << " CPU placement:";
+    if (!g_cpu_list.empty()) os << " CPUs " << cpus_to_string(g_cpus);
+    if (g_node >= 0) os << " NUMA node " << g_node;
+    os << endl;
+    for (size_t t = 0; t < g_threads.size(); t++) {
+        os << "  " << g_threads[t].role << ": CPU " << g_threads[t].allowed
+           << " (ran on " << g_threads[t].cpu << ")" << endl;
+    }
+    for (size_t b = 0; b < g_buffers.size(); b++) {
+        int node = node_of_address(g_buffers[b].addr);
+        os << "  " << g_buffers[b].name << ": ";
+        if (node >= 0) os << "node " << node << endl;
+        else os << "node unknown" << endl;
+    }
+    pthread_mutex_unlock(&g_lock);
+}
@@ -0,0 +1,36 @@
+/*
+ * placement.h
+ *
+ * CPU and NUMA placement of the process's threads and frame buffers
+ * (--cpu, --numa-node).
+ *
+ * Threads pin themselves with pin_thread(role, index). With a CPU list,
+ * thread index i is pinned to the i-th CPU of the list (wrapping around):
+ * index 0 is the thread running the main loop, producer threads count up
+ * from 1. With only a NUMA node, every thread may run on any CPU of the
+ * node. With a NUMA node, memory allocated after configure() is preferably
+ * placed on that node (set_mempolicy), so frame buffers allocated by the
+ * pinned threads are node local.
+ *
+ * There is one placement per process. The placement of each thread and the
+ * node holding each noted buffer are printed in the reports.
+ */
+
+#ifndef PLACEMENT_H_
+#define PLACEMENT_H_
+
+#include <string>
+#include <ostream>
+
+class CpuPlacement {
+public:
+    static void configure(const std::string& cpu_list, int numa_node);
+    static bool enabled();
+    static void pin_thread(const std::string& role, unsigned int index);
+    static void note_buffer(const std::string& name, const void * addr);
+    static void print(std::ostream& os);
+
+    static int node_of_address(const void * addr);   // -1: unknown
+};
+
+#endif /* PLACEMENT_H_ */
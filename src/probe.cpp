@@ -0,0 +1,76 @@
+#include <vector>
+#include <iomanip>
+#include <cstring>
+#include <pthread.h>
+
+#include "probe.h"
+
+using namespace std;
+
+static const char * phase_names[PROBE_NPHASES] = {
+    "extend", "pack", "select", "write", "flush", "refresh", "read", "verify"
+};
+
+// Each thread gets its own block of counters on first use. The blocks are
+// never freed so they remain valid for the report after the thread exits.
+static __thread ProbeCounter * t_counters = NULL;
+static vector<ProbeCounter *> g_blocks;
+static pthread_mutex_t g_blocks_lock = PTHREAD_MUTEX_INITIALIZER;
+
+ProbeCounter * Probes::thread_counters()
+{
+    if (t_counters == NULL) {
+        ProbeCounter * block = new ProbeCounter[PROBE_NPHASES];
+        memset(block, 0, sizeof(ProbeCounter) * PROBE_NPHASES);
+        pthread_mutex_lock(&g_blocks_lock);
+        g_blocks.push_back(block);
+        pthread_mutex_unlock(&g_blocks_lock);
+        t_counters = block;
+    }
+    return t_counters;
+}
+
+void Probes::reset()
+{
+    pthread_mutex_lock(&g_blocks_lock);
+    for (size_t i = 0; i < g_blocks.size(); i++) {
+        memset(g_blocks[i], 0, sizeof(ProbeCounter) * PROBE_NPHASES);
+    }
+    pthread_mutex_unlock(&g_blocks_lock);
+}
+
+const char * Probes::phase_name(ProbePhase phase)
+{
+    return phase_names[phase];
+}
+
+void Probes::print(ostream& os)
+{
+    ProbeCounter sum[PROBE_NPHASES];
+    memset(sum, 0, sizeof(sum));
+    pthread_mutex_lock(&g_blocks_lock);
+    size_t nthreads = g_blocks.size();
+    for (size_t i = 0; i < g_blocks.size(); i++) {
+        for (int p = 0; p < PROBE_NPHASES; p++) {
+            sum[p].calls += g_blocks[i][p].calls;
+            sum[p].total_ns += g_blocks[i][p].total_ns;
+            if (g_blocks[i][p].max_ns > sum[p].max_ns) sum[p].max_ns = g_blocks[i][p].max_ns;
+        }
+    }
+    pthread_mutex_unlock(&g_blocks_lock);
+    if (nthreads == 0) return;
+
+    os << setw(18) << "[phase]" << setw(10) << "calls"
+       << setw(12) << "total[ms]" << setw(10) << "mean[us]"
+       << setw(10) << "max[us]" << "   (" << nthreads << " thread(s))" << endl;
+    for (int p = 0; p < PROBE_NPHASES; p++) {
+        if (sum[p].calls == 0) continue;
+        os << setw(17) << phase_names[p] << ":" << setw(10) << sum[p].calls
+           << fixed << setprecision(3)
+           << setw(12) << sum[p].total_ns / 1E6
+           << setprecision(1)
+           << setw(10) << sum[p].total_ns / 1E3 / sum[p].calls
+           << setw(10) << sum[p].max_ns / 1E3 << endl;
+    }
+    os << endl;
+}
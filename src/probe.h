@@ -0,0 +1,74 @@
+/*
+ * probe.h
+ *
+ * Lightweight scoped timing probes for the writer and reader hot paths.
+ *
+ * Each thread accumulates its own counters (calls, total and max duration)
+ * per phase without any locking. The per-thread blocks are registered once
+ * and summed when the report is printed.
+ *
+ * Probes are compiled in when SWMR_ENABLE_PROBES is defined (cmake option
+ * ENABLE_PROBES). Otherwise SWMR_PROBE() expands to nothing.
+ */
+
+#ifndef PROBE_H_
+#define PROBE_H_
+
+#include <ostream>
+#include <stdint.h>
+
+#include "timestamp.h"
+
+enum ProbePhase {
+    PROBE_EXTEND = 0,
+    PROBE_PACK,
+    PROBE_SELECT,
+    PROBE_WRITE,
+    PROBE_FLUSH,
+    PROBE_REFRESH,
+    PROBE_READ,
+    PROBE_VERIFY,
+    PROBE_NPHASES
+};
+
+struct ProbeCounter {
+    uint64_t calls;
+    uint64_t total_ns;
+    uint64_t max_ns;
+};
+
+class Probes {
+public:
+    static ProbeCounter * thread_counters();
+    static void reset();
+    static void print(std::ostream& os);
+    static const char * phase_name(ProbePhase phase);
+};
+
+class ScopedProbe {
+public:
+    ScopedProbe(ProbePhase phase)
+    : m_counter(Probes::thread_counters() + phase), m_start(TimeStamp::now_ns())
+    {}
+    ~ScopedProbe()
+    {
+        uint64_t dt = TimeStamp::now_ns() - m_start;
+        m_counter->calls++;
+        m_counter->total_ns += dt;
+        if (dt > m_counter->max_ns) m_counter->max_ns = dt;
+    }
+private:
+    ProbeCounter * m_counter;
+    uint64_t m_start;
+};
+
+#define SWMR_PROBE_CAT2(a, b) a##b
+#define SWMR_PROBE_CAT(a, b) SWMR_PROBE_CAT2(a, b)
+
+#ifdef SWMR_ENABLE_PROBES
+#define SWMR_PROBE(phase) ScopedProbe SWMR_PROBE_CAT(probe_, __LINE__)(phase)
+#else
+#define SWMR_PROBE(phase) do {} while (0)
+#endif
+
+#endif /* PROBE_H_ */
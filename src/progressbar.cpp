@@ -0,0 +1,73 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <csignal>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#include "progressbar.h"
+
+using namespace std;
+
+static const unsigned short DEFAULT_COLUMNS = 80;
+
+static volatile sig_atomic_t g_winch = 1; // query the width on first use
+static bool g_handler_installed = false;
+static unsigned short g_columns = DEFAULT_COLUMNS;
+
+static void handle_sigwinch(int)
+{
+    g_winch = 1;
+}
+
+static unsigned short terminal_columns()
+{
+    if (g_winch) {
+        g_winch = 0;
+        struct winsize w;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &w) == 0 && w.ws_col > 0) {
+            g_columns = w.ws_col;
+        } else {
+            g_columns = DEFAULT_COLUMNS;
+        }
+    }
+    return g_columns;
+}
+
+ProgressBar::ProgressBar(unsigned int nitems, bool enable, double update_hz)
+: m_enabled(enable), m_done(false), m_nitems(nitems), m_next_ns(0)
+{
+    m_interval_ns = static_cast<uint64_t>(1E9 / update_hz);
+    if (!isatty(STDOUT_FILENO)) m_enabled = false;
+
+    if (m_enabled && !g_handler_installed) {
+        struct sigaction sa;
+        sa.sa_handler = handle_sigwinch;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART;
+        sigaction(SIGWINCH, &sa, NULL);
+        g_handler_installed = true;
+    }
+}
+
+void ProgressBar::draw(unsigned int progress, double rate)
+{
+    if (m_done) return;
+    m_next_ns = TimeStamp::now_ns() + m_interval_ns;
+
+    int bar_width = terminal_columns() - 22;
+    if (bar_width < 1) bar_width = 1;
+    if (progress > m_nitems) progress = m_nitems;
+
+    float ratio = m_nitems > 0 ? progress/(float)m_nitems : 1.0;
+    int   c     = ratio * bar_width;
+
+    string bar(c, '=');
+    bar.append(bar_width - c, ' ');
+    cout << setw(3) << (int)(ratio*100) << "% [" << bar
+         << "] [" << fixed << setw(6) << setprecision(1) << rate << "MB/s]\r" << flush;
+    if (progress >= m_nitems) {
+        cout << endl;
+        m_done = true;
+    }
+}
@@ -1,28 +1,38 @@
 #ifndef PROGRESSBAR_H_
 #define PROGRESSBAR_H_
 
-#include <iostream>
-#include <iomanip>
-#include <sys/ioctl.h>
-#include <cstdio>
+#include <stdint.h>
 
-static inline void progressbar(unsigned int progress, unsigned int nitems,
-                               double rate = 0.)
-{
-    struct winsize w;
-    ioctl(0, TIOCGWINSZ, &w);
-    unsigned short int bar_width = w.ws_col - 22;
+#include "timestamp.h"
 
-    if ( (progress != nitems) && (progress % (nitems/100+1) != 0) ) return;
- 
-    float ratio  =  progress/(float)nitems;
-    int   c      =  ratio * bar_width;
- 
-    std::cout << std::setw(3) << (int)(ratio*100) << "% [";
-    for (int x=0; x<c; x++) std::cout << "=";
-    for (int x=c; x<bar_width; x++) std::cout << " ";
-    std::cout << "] ["<< std::fixed << std::setw(6)  << std::setprecision(1) << rate <<"MB/s]\r" << std::flush;
-    if (progress >= nitems) std::cout << std::endl;
-}
+/*
+ * Terminal progress bar for the writer and reader loops.
+ *
+ * update() is cheap enough to call for every frame: the bar is only redrawn
+ * at a limited rate (default 10Hz) and is disabled altogether when stdout is
+ * not a terminal. The terminal width is cached and only queried again after
+ * a SIGWINCH.
+ */
+class ProgressBar {
+public:
+    ProgressBar(unsigned int nitems, bool enable = true, double update_hz = 10.0);
+    ~ProgressBar(){};
+
+    inline void update(unsigned int progress, double rate = 0.)
+    {
+        if (!m_enabled) return;
+        if (progress < m_nitems && TimeStamp::now_ns() < m_next_ns) return;
+        this->draw(progress, rate);
+    }
+
+private:
+    void draw(unsigned int progress, double rate);
+
+    bool m_enabled;
+    bool m_done;
+    unsigned int m_nitems;
+    uint64_t m_interval_ns;
+    uint64_t m_next_ns;
+};
 
 #endif /* PROGRESSBAR_H_ */
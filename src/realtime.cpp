@@ -0,0 +1,102 @@
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <log4cxx/logger.h>
+using namespace log4cxx;
+
+#include "realtime.h"
+
+using namespace std;
+
+RealtimeMode::RealtimeMode()
+: m_log(Logger::getLogger("RealtimeMode")), m_enabled(false), m_fifo_priority(0),
+  m_buffers(0), m_locked_bytes(0), m_lock_failures(0), m_restore_sched(false),
+  m_saved_policy(SCHED_OTHER), m_saved_priority(0), m_finished(false)
+{
+    memset(&m_before, 0, sizeof(m_before));
+    memset(&m_after, 0, sizeof(m_after));
+}
+
+void RealtimeMode::configure(bool enabled, int fifo_priority)
+{
+    m_enabled = enabled;
+    m_fifo_priority = fifo_priority;
+}
+
+void RealtimeMode::lock_buffer(const void * addr, size_t bytes)
+{
+    if (!m_enabled || addr == NULL || bytes == 0) return;
+    m_buffers++;
+    if (mlock(addr, bytes) == 0) {
+        m_locked_bytes += bytes;
+    } else {
+        m_lock_failures++;
+        LOG4CXX_WARN(m_log, "mlock of " << bytes << " bytes failed: " << strerror(errno));
+    }
+
+    /* mlock faults the pages in, but touch them anyway in case it failed */
+    long page = sysconf(_SC_PAGESIZE);
+    const volatile char * p = static_cast<const volatile char *>(addr);
+    for (size_t offset = 0; offset < bytes; offset += page) (void)p[offset];
+    (void)p[bytes - 1];
+}
+
+void RealtimeMode::start()
+{
+    if (m_enabled && m_fifo_priority > 0) {
+        struct sched_param param;
+        if (pthread_getschedparam(pthread_self(), &m_saved_policy, &param) == 0) {
+            m_saved_priority = param.sched_priority;
+        }
+        param.sched_priority = m_fifo_priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        ostringstream oss;
+        if (err == 0) {
+            m_restore_sched = true;
+            oss << "SCHED_FIFO priority " << m_fifo_priority;
+        } else {
+            oss << "SCHED_FIFO refused (" << strerror(err) << ")";
+            LOG4CXX_WARN(m_log, "Unable to set SCHED_FIFO priority " << m_fifo_priority
+                         << ": " << strerror(err));
+        }
+        m_sched_result = oss.str();
+    } else {
+        m_sched_result = "scheduling unchanged";
+    }
+    getrusage(RUSAGE_SELF, &m_before);
+    m_finished = false;
+}
+
+void RealtimeMode::finish()
+{
+    getrusage(RUSAGE_SELF, &m_after);
+    m_finished = true;
+    if (m_restore_sched) {
+        struct sched_param param;
+        param.sched_priority = m_saved_priority;
+        pthread_setschedparam(pthread_self(), m_saved_policy, &param);
+        m_restore_sched = false;
+    }
+}
+
+void RealtimeMode::print(ostream& os) const
+{
+    if (!m_finished) return;
+    if (m_enabled) {
+        os << " Realtime mode: " << m_sched_result << ", " << m_buffers
+           << " frame buffer(s) prefaulted, " << m_locked_bytes << " bytes locked";
+        if (m_lock_failures > 0) os << " (" << m_lock_failures << " mlock failures)";
+        os << endl;
+    }
+    os << " Page faults:         minor     major" << endl
+       << "   before loop: " << setw(11) << m_before.ru_minflt
+       << setw(10) << m_before.ru_majflt << endl
+       << "   in loop:     " << setw(11) << m_after.ru_minflt - m_before.ru_minflt
+       << setw(10) << m_after.ru_majflt - m_before.ru_majflt << endl << endl;
+}
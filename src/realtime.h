@@ -0,0 +1,50 @@
+/*
+ * realtime.h
+ *
+ * Real-time mode for the write loop (--realtime), as detector receivers
+ * run: the frame buffers are locked in memory and prefaulted before the
+ * loop, and the loop thread optionally runs with SCHED_FIFO priority. The
+ * minor and major page faults of the process (getrusage) are sampled
+ * before and after the loop so the faults taken in the loop are reported,
+ * with or without real-time mode.
+ *
+ * Locking memory and real-time priority need privileges (RLIMIT_MEMLOCK,
+ * CAP_SYS_NICE): if they are refused the loop still runs, and the report
+ * says what could not be set up.
+ */
+
+#ifndef REALTIME_H_
+#define REALTIME_H_
+
+#include <string>
+#include <ostream>
+#include <sys/resource.h>
+#include <log4cxx/logger.h>
+
+class RealtimeMode {
+public:
+    RealtimeMode();
+    void configure(bool enabled, int fifo_priority);
+    bool enabled() const { return m_enabled; }
+    void lock_buffer(const void * addr, size_t bytes);
+    void start();
+    void finish();
+    void print(std::ostream& os) const;
+
+private:
+    LoggerPtr m_log;
+    bool m_enabled;
+    int m_fifo_priority;          // 0: keep the scheduling policy
+    std::string m_sched_result;
+    unsigned int m_buffers;
+    size_t m_locked_bytes;
+    unsigned int m_lock_failures;
+    bool m_restore_sched;
+    int m_saved_policy;
+    int m_saved_priority;
+    struct rusage m_before;
+    struct rusage m_after;
+    bool m_finished;
+};
+
+#endif /* REALTIME_H_ */
@@ -0,0 +1,197 @@
+#include <stdexcept>
+#include <sstream>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <climits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <assert.h>
+
+#include <log4cxx/logger.h>
+using namespace log4cxx;
+
+#include "timestamp.h"
+#include "refcache.h"
+
+using namespace std;
+
+#define REFCACHE_MAGIC   0x53574d46 /* "SWMF" */
+#define REFCACHE_VERSION 1
+#define REFCACHE_KEYLEN  1024
+
+struct RefCacheHeader {
+    uint32_t magic;          // written last, once the frame is complete
+    uint32_t version;
+    char key[REFCACHE_KEYLEN];
+    uint64_t dims[2];
+    uint64_t data_offset;    // from the start of the segment, page aligned
+};
+
+/* File identity: canonical path, dataset, inode, size and mtime */
+static string cache_key(const string& fname, const string& dsetname)
+{
+    char path[PATH_MAX];
+    struct stat st;
+    if (realpath(fname.c_str(), path) == NULL || stat(path, &st) != 0) {
+        throw runtime_error("Unable to stat test data file " + fname
+                            + ": " + strerror(errno));
+    }
+    ostringstream oss;
+    oss << path << ":" << dsetname << ":" << st.st_dev << ":" << st.st_ino
+        << ":" << st.st_size << ":" << st.st_mtim.tv_sec << "."
+        << st.st_mtim.tv_nsec;
+    return oss.str();
+}
+
+/* 64 bit FNV-1a */
+static uint64_t fnv1a(const string& s)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < s.size(); i++) {
+        h ^= static_cast<unsigned char>(s[i]);
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+RefFrameCache::RefFrameCache()
+: m_log(Logger::getLogger("RefFrameCache")), m_addr(NULL), m_size(0), m_hit(false)
+{
+}
+
+RefFrameCache::~RefFrameCache()
+{
+    this->unmap();
+}
+
+string RefFrameCache::segment_name(const string& fname, const string& dsetname)
+{
+    ostringstream oss;
+    oss << "/swmr-ref-" << hex << fnv1a(cache_key(fname, dsetname));
+    return oss.str();
+}
+
+bool RefFrameCache::hit() const
+{
+    return m_hit;
+}
+
+Frame RefFrameCache::load(const string& fname, const string& dsetname)
+{
+    TimeStamp ts;
+    string key = cache_key(fname, dsetname);
+    if (key.size() >= REFCACHE_KEYLEN) {
+        throw runtime_error("Test data file path too long for the reference cache: " + fname);
+    }
+    string name = RefFrameCache::segment_name(fname, dsetname);
+
+    m_hit = this->attach(name, key);
+    if (!m_hit) {
+        Frame frame(fname, dsetname);
+        this->store(name, key, frame);
+        /* Use the shared pages from now on, even if another reader won the
+         * race to create the segment */
+        if (!this->attach(name, key)) return frame;
+    }
+    LOG4CXX_DEBUG(m_log, "Reference frame " << (m_hit ? "mapped from" : "stored in")
+                  << " shared cache " << name << " in "
+                  << ts.seconds_until_now() * 1000. << " ms");
+    return this->frame();
+}
+
+bool RefFrameCache::attach(const string& name, const string& key)
+{
+    this->unmap();
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t) sizeof(RefCacheHeader)) {
+        close(fd);
+        return false;
+    }
+    void * addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) return false;
+    m_addr = addr;
+    m_size = st.st_size;
+
+    const RefCacheHeader * hdr = static_cast<const RefCacheHeader *>(m_addr);
+    if (hdr->magic != REFCACHE_MAGIC) {
+        // Being written by another reader (or abandoned): do not wait for it
+        LOG4CXX_DEBUG(m_log, "Shared reference cache " << name << " not ready");
+        this->unmap();
+        return false;
+    }
+    __sync_synchronize();
+    size_t nbytes = hdr->dims[0] * hdr->dims[1] * sizeof(uint32_t);
+    if (hdr->version != REFCACHE_VERSION || key != hdr->key ||
+        hdr->data_offset + nbytes > m_size) {
+        LOG4CXX_WARN(m_log, "Ignoring stale or mismatched reference cache " << name);
+        this->unmap();
+        return false;
+    }
+    return true;
+}
+
+void RefFrameCache::store(const string& name, const string& key, Frame& frame)
+{
+    assert(frame.dimensions().size() == 2);
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t data_offset = (sizeof(RefCacheHeader) + page - 1) / page * page;
+    size_t size = data_offset + frame.num_bytes_img();
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        if (errno == EEXIST) return; // another reader is creating it
+        LOG4CXX_WARN(m_log, "Unable to create shared reference cache " << name
+                     << ": " << strerror(errno));
+        return;
+    }
+    void * addr = MAP_FAILED;
+    if (ftruncate(fd, size) == 0) {
+        addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (addr == MAP_FAILED) {
+        LOG4CXX_WARN(m_log, "Unable to size shared reference cache " << name
+                     << ": " << strerror(errno));
+        shm_unlink(name.c_str());
+        return;
+    }
+
+    RefCacheHeader * hdr = static_cast<RefCacheHeader *>(addr);
+    hdr->version = REFCACHE_VERSION;
+    strncpy(hdr->key, key.c_str(), REFCACHE_KEYLEN - 1);
+    hdr->dims[0] = frame.dimensions()[0];
+    hdr->dims[1] = frame.dimensions()[1];
+    hdr->data_offset = data_offset;
+    memcpy(static_cast<char *>(addr) + data_offset, frame.pdata(),
+           frame.num_bytes_img());
+    __sync_synchronize();
+    hdr->magic = REFCACHE_MAGIC;
+    munmap(addr, size);
+}
+
+Frame RefFrameCache::frame() const
+{
+    const RefCacheHeader * hdr = static_cast<const RefCacheHeader *>(m_addr);
+    vector<hsize_t> dims(2);
+    dims[0] = hdr->dims[0];
+    dims[1] = hdr->dims[1];
+    /* Shallow copy of the read-only mapping: Frame never writes its data */
+    uint32_t * pdata = reinterpret_cast<uint32_t *>(
+            static_cast<char *>(m_addr) + hdr->data_offset);
+    return Frame(dims, pdata);
+}
+
+void RefFrameCache::unmap()
+{
+    if (m_addr != NULL) {
+        munmap(m_addr, m_size);
+        m_addr = NULL;
+        m_size = 0;
+    }
+}
@@ -0,0 +1,51 @@
+/*
+ * refcache.h
+ *
+ * Reference frame cache shared between reader processes.
+ *
+ * The first reader to load a reference frame from a test data file stores
+ * it in a POSIX shared memory segment. Later readers map the segment
+ * read-only instead of opening the HDF5 file, so they start up in
+ * milliseconds and share the same physical pages.
+ *
+ * The segment name is derived from the canonical path of the test data
+ * file, the dataset name and the file's inode, size and modification time:
+ * rewriting the test data file gives a new segment. The full key is also
+ * stored in the segment header and checked on attach.
+ */
+
+#ifndef REFCACHE_H_
+#define REFCACHE_H_
+
+#include <string>
+#include <stdint.h>
+
+#include "frame.h"
+
+class RefFrameCache {
+public:
+    RefFrameCache();
+    ~RefFrameCache();
+
+    Frame load(const std::string& fname, const std::string& dsetname);
+    bool hit() const;
+
+    static std::string segment_name(const std::string& fname,
+                                    const std::string& dsetname);
+
+private:
+    RefFrameCache(const RefFrameCache&);            // not copyable
+    RefFrameCache& operator=(const RefFrameCache&);
+
+    bool attach(const std::string& name, const std::string& key);
+    void store(const std::string& name, const std::string& key, Frame& frame);
+    Frame frame() const;
+    void unmap();
+
+    LoggerPtr m_log;
+    void * m_addr;
+    size_t m_size;
+    bool m_hit;
+};
+
+#endif /* REFCACHE_H_ */
@@ -0,0 +1,124 @@
+#include <cstring>
+#include <stdexcept>
+#include <iomanip>
+
+#include "timestamp.h"
+#include "placement.h"
+#include "ringbench.h"
+
+using namespace std;
+
+RingBenchmark::RingBenchmark(size_t nslots, size_t frame_bytes, unsigned int nproducers)
+: m_ring(nslots, sizeof(SlotStamp) + frame_bytes, nproducers > 1),
+  m_frame_bytes(frame_bytes), m_frame(frame_bytes),
+  m_nproducers(nproducers < 1 ? 1 : nproducers),
+  m_nframes(0), m_seconds(0.0), m_errors(0)
+{
+    for (size_t b = 0; b < m_frame.size(); b++) m_frame[b] = static_cast<char>(b);
+    CpuPlacement::note_buffer("ring slots", m_ring.slot(0));
+}
+
+void * RingBenchmark::producer_main(void * arg)
+{
+    Producer * producer = static_cast<Producer *>(arg);
+    CpuPlacement::pin_thread("producer", producer->id + 1);
+    producer->owner->produce(*producer);
+    return NULL;
+}
+
+void RingBenchmark::produce(const Producer& producer)
+{
+    for (unsigned long long f = 0; f < producer.nframes; f++) {
+        uint64_t ticket = m_ring.claim();
+        char * slot = static_cast<char *>(m_ring.slot(ticket));
+        if (m_frame_bytes > 0) memcpy(slot + sizeof(SlotStamp), &m_frame[0], m_frame_bytes);
+        SlotStamp * stamp = reinterpret_cast<SlotStamp *>(slot);
+        stamp->producer = producer.id;
+        stamp->seq = f;
+        stamp->publish_ns = TimeStamp::now_ns();
+        m_ring.publish(ticket);
+    }
+}
+
+unsigned long long RingBenchmark::run(unsigned long long nframes)
+{
+    m_nframes = nframes;
+    m_errors = 0;
+    m_handoff.reset();
+
+    // Producer 0 takes the remainder
+    vector<Producer> producers(m_nproducers);
+    for (unsigned int p = 0; p < m_nproducers; p++) {
+        producers[p].owner = this;
+        producers[p].id = p;
+        producers[p].nframes = nframes / m_nproducers;
+    }
+    producers[0].nframes += nframes % m_nproducers;
+
+    TimeStamp ts;
+    vector<pthread_t> threads;
+    unsigned long long nproduced = 0;
+    int err = 0;
+    for (unsigned int p = 0; p < m_nproducers && err == 0; p++) {
+        pthread_t thread;
+        err = pthread_create(&thread, NULL, RingBenchmark::producer_main, &producers[p]);
+        if (err == 0) {
+            threads.push_back(thread);
+            nproduced += producers[p].nframes;
+        }
+    }
+
+    /* If a producer did not start, still drain the ones which did so that
+     * they can finish */
+    vector<uint64_t> expected(m_nproducers, 0);
+    for (unsigned long long f = 0; f < nproduced; f++) {
+        uint64_t ticket = m_ring.consume();
+        const char * slot = static_cast<const char *>(m_ring.slot(ticket));
+        const SlotStamp * stamp = reinterpret_cast<const SlotStamp *>(slot);
+        m_handoff.record(TimeStamp::now_ns() - stamp->publish_ns);
+        if (stamp->producer >= m_nproducers || stamp->seq != expected[stamp->producer]) {
+            m_errors++;
+        } else {
+            expected[stamp->producer]++;
+        }
+        if (m_frame_bytes > 0 &&
+            (slot[sizeof(SlotStamp)] != m_frame[0] ||
+             slot[sizeof(SlotStamp) + m_frame_bytes - 1] != m_frame[m_frame_bytes - 1])) {
+            m_errors++;
+        }
+        m_ring.release(ticket);
+    }
+
+    for (size_t p = 0; p < threads.size(); p++) pthread_join(threads[p], NULL);
+    m_seconds = ts.seconds_until_now();
+    if (err != 0) {
+        throw runtime_error(string("Unable to start the ring benchmark producers: ")
+                            + strerror(err));
+    }
+    return m_errors;
+}
+
+void RingBenchmark::print(ostream& os) const
+{
+    os << " Frame ring: " << m_ring.nslots() << " slots of " << m_ring.slot_bytes()
+       << " bytes, " << m_nproducers << " producer(s) ("
+       << (m_ring.multi_producer() ? "MPSC" : "SPSC") << ")" << endl;
+    os << fixed << setprecision(3)
+       << " Frames: " << m_nframes << " in " << m_seconds << "s";
+    if (m_seconds > 0.) {
+        os << setprecision(0) << ": " << m_nframes / m_seconds << " frames/s, "
+           << setprecision(1) << m_nframes * m_frame_bytes / (1024. * 1024. * m_seconds)
+           << " MB/s";
+    }
+    os << endl << endl;
+    LatencyHistogram::print_header(os);
+    m_handoff.print(os, "hand-off:");
+    os << endl
+       << " Ring full: " << m_ring.full_spins() << " producer spins, empty: "
+       << m_ring.empty_spins() << " consumer spins" << endl
+       << " Ordering errors: " << m_errors << endl;
+    if (CpuPlacement::enabled()) {
+        os << endl;
+        CpuPlacement::print(os);
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * ringbench.h
+ *
+ * Hand-off benchmark for FrameRing ('swmr ringbench').
+ *
+ * One or more producer threads copy a frame into each claimed slot, stamp
+ * it with the producer, its sequence number and the time, and publish it.
+ * The calling thread consumes the frames and records the hand-off latency
+ * from publish to consume. Frames from each producer must arrive in order.
+ */
+
+#ifndef RINGBENCH_H_
+#define RINGBENCH_H_
+
+#include <vector>
+#include <ostream>
+#include <pthread.h>
+#include <stdint.h>
+
+#include "framering.h"
+#include "histogram.h"
+
+class RingBenchmark {
+public:
+    RingBenchmark(size_t nslots, size_t frame_bytes, unsigned int nproducers);
+    unsigned long long run(unsigned long long nframes);
+    void print(std::ostream& os) const;
+
+private:
+    struct SlotStamp {
+        uint64_t producer;
+        uint64_t seq;
+        uint64_t publish_ns;
+    };
+    struct Producer {
+        RingBenchmark * owner;
+        unsigned int id;
+        unsigned long long nframes;
+    };
+    static void * producer_main(void * arg);
+    void produce(const Producer& producer);
+
+    FrameRing m_ring;
+    size_t m_frame_bytes;
+    std::vector<char> m_frame;         // copied into every slot
+    unsigned int m_nproducers;
+    unsigned long long m_nframes;
+    double m_seconds;
+    unsigned long long m_errors;       // frames out of order or corrupted
+    LatencyHistogram m_handoff;        // publish to consume
+};
+
+#endif /* RINGBENCH_H_ */
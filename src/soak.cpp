@@ -0,0 +1,87 @@
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+
+#include "soak.h"
+
+using namespace std;
+
+SoakReporter::SoakReporter()
+: m_enabled(false), m_interval_ns(0), m_drift_pct(10.0),
+  m_frames(0), m_mbytes(0.0), m_drift_count(0)
+{
+}
+
+void SoakReporter::configure(double interval, double drift_pct)
+{
+    m_enabled = interval > 0.0;
+    m_interval_ns = static_cast<uint64_t>(interval * 1E9);
+    m_drift_pct = drift_pct;
+}
+
+bool SoakReporter::enabled() const
+{
+    return m_enabled;
+}
+
+void SoakReporter::start()
+{
+    m_ts.reset();
+    m_total_ts.reset();
+    m_frames = 0;
+    m_mbytes = 0.0;
+    m_write.reset();
+    m_flush.reset();
+    m_rates.clear();
+    m_drift_count = 0;
+}
+
+string SoakReporter::report(unsigned long long frames, double mbytes, bool& drifted)
+{
+    double dt = m_ts.seconds_until_now();
+    m_ts.reset();
+    double rate = (frames - m_frames) / dt;
+    double datarate = (mbytes - m_mbytes) / dt;
+    m_frames = frames;
+    m_mbytes = mbytes;
+
+    double drift = 0.0;
+    if (!m_rates.empty() && m_rates.front() > 0.0) {
+        drift = (rate / m_rates.front() - 1.0) * 100.0;
+    }
+    drifted = drift < -m_drift_pct;
+    if (drifted) m_drift_count++;
+    m_rates.push_back(rate);
+
+    ostringstream oss;
+    oss << fixed << setprecision(1)
+        << "[" << setw(8) << m_total_ts.seconds_until_now() << "s]"
+        << " frames: " << setw(9) << frames
+        << " rate: " << setw(8) << rate << "Hz " << setw(7) << datarate << "MB/s"
+        << " write p50/p99/max: " << m_write.percentile(50.0) / 1000.
+        << "/" << m_write.percentile(99.0) / 1000.
+        << "/" << m_write.max() / 1000. << "us"
+        << " flush p99/max: " << m_flush.percentile(99.0) / 1000.
+        << "/" << m_flush.max() / 1000. << "us"
+        << " size: " << mbytes << "MB"
+        << " drift: " << showpos << drift << noshowpos << "%";
+    if (drifted) oss << " DRIFT";
+
+    m_write.reset();
+    m_flush.reset();
+    return oss.str();
+}
+
+void SoakReporter::print_summary(ostream& os) const
+{
+    if (!m_enabled || m_rates.empty()) return;
+    os << fixed << setprecision(1)
+       << " Soak intervals:      " << m_rates.size() << endl
+       << "  first/last rate:    " << m_rates.front() << "Hz / "
+       << m_rates.back() << "Hz" << endl
+       << "  min/max rate:       "
+       << *min_element(m_rates.begin(), m_rates.end()) << "Hz / "
+       << *max_element(m_rates.begin(), m_rates.end()) << "Hz" << endl
+       << "  drifted intervals:  " << m_drift_count
+       << " (threshold -" << m_drift_pct << "%)" << endl << endl;
+}
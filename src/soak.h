@@ -0,0 +1,54 @@
+/*
+ * soak.h
+ *
+ * Interval reporting for long running (soak) writes.
+ *
+ * Every interval the reporter summarises the frame rate, data rate and the
+ * write/flush latency percentiles of the frames in that interval. The frame
+ * rate of the first interval is taken as the baseline and any later interval
+ * which falls more than the drift threshold below it is flagged.
+ */
+
+#ifndef SOAK_H_
+#define SOAK_H_
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <stdint.h>
+
+#include "histogram.h"
+#include "timestamp.h"
+
+class SoakReporter {
+public:
+    SoakReporter();
+    ~SoakReporter(){};
+    void configure(double interval, double drift_pct);
+    bool enabled() const;
+    void start();
+
+    inline void record_write(uint64_t ns) { m_write.record(ns); }
+    inline void record_flush(uint64_t ns) { m_flush.record(ns); }
+    inline bool due() { return m_enabled && m_ts.nanoseconds_until_now() >= m_interval_ns; }
+
+    std::string report(unsigned long long frames, double mbytes, bool& drifted);
+    void print_summary(std::ostream& os) const;
+
+private:
+    bool m_enabled;
+    uint64_t m_interval_ns;
+    double m_drift_pct;
+
+    TimeStamp m_ts;
+    TimeStamp m_total_ts;
+    unsigned long long m_frames;
+    double m_mbytes;
+    LatencyHistogram m_write;
+    LatencyHistogram m_flush;
+
+    std::vector<double> m_rates;
+    unsigned int m_drift_count;
+};
+
+#endif /* SOAK_H_ */
@@ -2,7 +2,13 @@
 #include <iostream>
 #include <iomanip>
 #include <iterator>
+#include <sstream>
+#include <fstream>
 #include <assert.h>
+#include <cerrno>
+#include <ctime>
+#include <signal.h>
+#include <unistd.h>
 
 #include <log4cxx/logger.h>
 #include <log4cxx/xml/domconfigurator.h>
@@ -19,6 +25,11 @@ using boost::any_cast;
 
 #include "swmr-reader.h"
 #include "swmr-writer.h"
+#include "timestamp.h"
+#include "livestats.h"
+#include "mdclog.h"
+#include "ringbench.h"
+#include "placement.h"
 
 using namespace std;
 
@@ -34,8 +45,12 @@ public:
 private:
     int run_read();
     int run_write();
+    int run_stat();
+    int run_mdclog();
+    int run_ringbench();
+    void configure_placement(const std::string& main_role);
 
-    enum {help, read, write} m_subcmd;
+    enum {help, read, write, stat, mdclog, ringbench} m_subcmd;
     LoggerPtr m_log;
     int m_argc;
     char **m_argv;
@@ -75,6 +90,12 @@ void SwmrDemoCli::main_args(int argc, char* argv[])
         m_subcmd = read;
     } else if (subcmd == "write" or subcmd == "w") {
         m_subcmd = write;
+    } else if (subcmd == "stat") {
+        m_subcmd = stat;
+    } else if (subcmd == "mdclog") {
+        m_subcmd = mdclog;
+    } else if (subcmd == "ringbench") {
+        m_subcmd = ringbench;
     } else {
         LOG4CXX_ERROR(m_log, "ERROR: Unknown subcommand: " << subcmd );
     }
@@ -111,14 +132,19 @@ void SwmrDemoCli::parse_options()
         ("testdataset,d", po::value<string>()->default_value("data"),
                 "HDF5 reference dataset name")
         ("logconfig,l", po::value<string>(),
-                "Log4CXX XML configuration file");
+                "Log4CXX XML configuration file")
+        ("tsc", "Use the calibrated CPU timestamp counter for timing")
+        ("cpu", po::value<string>(),
+                "Pin threads to CPUs in this list (e.g. 2,3 or 4-7): the main loop to the first, producer threads to the next")
+        ("numa-node", po::value<int>(),
+                "Run threads on the CPUs of this NUMA node and allocate frame buffers on it");
 
     po::options_description cmd_options_description("Command options");
     switch(m_subcmd) {
     case help:
         // ignore any other options set
         desc_string =  "Usage:\n  swmr SUBCMD [options] [DATAFILE]\n\n"
-                       "    SUBCMD:   The subcommand to run (help|read|write)\n"
+                       "    SUBCMD:   The subcommand to run (help|read|write|stat|mdclog|ringbench)\n"
                        "    DATAFILE: The HDF5 SWMR datafile to operate on.\n\n"
                        "Option Groups";
         //cmd_options_description.add(po::options_description(desc_string)).add(common_opts);
@@ -134,7 +160,28 @@ void SwmrDemoCli::parse_options()
             ("timeout,t", po::value<double>()->default_value(2.0),
                     "Timeout [sec] waiting for new data")
             ("polltime,p", po::value<double>()->default_value(1.0),
-                    "Monitor polling time [sec]");
+                    "Monitor polling time [sec]")
+            ("stats", po::value<string>(),
+                    "Publish live statistics in shared memory segment NAME")
+            ("cache-mb", po::value<double>()->default_value(0.0),
+                    "Raw data chunk cache size [MB] (0: auto-tune)")
+            ("roi", po::value< vector<string> >()->composing(),
+                    "Only read and verify region of interest ROW,COL,ROWS,COLS (repeat for multiple regions)")
+            ("roi-align", "Expand regions of interest to chunk boundaries")
+            ("frame-records", "Read and check the per-frame records written with 'swmr write --frame-records'")
+            ("timestamps", "Analyse the frame timestamps written with 'swmr write --timestamps'")
+            ("engine", po::value<string>()->default_value("latest"),
+                    "How new frames are read: 'latest' frame only, or every new frame with 'h5ld'")
+            ("read-attempts", po::value<int>()->default_value(0),
+                    "Metadata read attempts on checksum failure (0: library default)")
+            ("mdc-log", po::value<string>(),
+                    "Log metadata cache operations to this file (see 'swmr mdclog')")
+            ("trace-io", "Open the file with the trace driver to count chunk cache misses")
+            ("ref-cache", "Share the reference frame between readers through a shared memory cache")
+            ("preview", po::value<double>(),
+                    "Live preview mode: read at most one frame per display interval [sec]")
+            ("bin", po::value<int>()->default_value(2),
+                    "Live preview mode: bin NxN pixels into one preview pixel");
         break;
     case write:
         desc_string =  "Usage:\n  swmr write [options] [DATAFILE]\n\n"
@@ -146,7 +193,85 @@ void SwmrDemoCli::parse_options()
                     "Number of write iterations")
             ("chunk,c", po::value<int>()->default_value(1),
                     "Number of chunked frames")
-            ("direct", "Use optimised direct chunk write");
+            ("direct", "Use optimised direct chunk write")
+            ("cache-mb", po::value<double>()->default_value(0.0),
+                    "Raw data chunk cache size [MB] (0: auto-tune)")
+            ("tile", po::value<string>(),
+                    "Chunk tile shape ROWSxCOLS (default: test data chunking)")
+            ("tile-threads", po::value<int>()->default_value(1),
+                    "Number of threads packing tiles for direct chunk write")
+            ("chunk-index", po::value<string>()->default_value("earray"),
+                    "Chunk index type (earray|bt2)")
+            ("dont-filter-partial-chunks", "Do not filter partial edge chunks")
+            ("mdc-log", po::value<string>(),
+                    "Log metadata cache operations to this file (see 'swmr mdclog')")
+            ("frame-records", po::value<int>(),
+                    "Append a per-frame record to a packet table, in batches of N records")
+            ("timestamps", "Record the time each frame was written in a 'timestamps' dataset")
+            ("realtime", "Lock and prefault the frame buffers before the write loop")
+            ("rt-priority", po::value<int>(),
+                    "Realtime mode: run the write loop with SCHED_FIFO at this priority (1-99)")
+            ("flush-batch", po::value<int>(),
+                    "Hold metadata in the cache and flush every N frames (default: every chunk)")
+            ("driver", po::value<string>()->default_value("sec2"),
+                    "HDF5 file driver (sec2|core|stdio|direct|trace)")
+            ("backing-store", "Core driver: write the file to disk when it is closed")
+            ("trace-file", po::value<string>(),
+                    "Trace driver: dump every read/write/truncate/flush to this CSV file")
+            ("coalesce", po::value<int>()->default_value(0),
+                    "Trace driver: coalesce adjacent writes smaller than this [bytes]")
+            ("rate,r", po::value<double>(),
+                    "Pace frames at a fixed rate [Hz] (default: as fast as possible)")
+            ("burst", po::value<int>(),
+                    "Write bursts of N frames at --rate")
+            ("burst-period", po::value<double>(),
+                    "Period [sec] between the start of each burst")
+            ("duration", po::value<double>(),
+                    "Soak mode: write for this long [sec]")
+            ("max-size", po::value<double>(),
+                    "Soak mode: write until the dataset reaches this size [MB]")
+            ("report-interval", po::value<double>()->default_value(10.0),
+                    "Soak mode: interval between reports [sec]")
+            ("drift", po::value<double>()->default_value(10.0),
+                    "Soak mode: flag intervals with a frame rate this far below the first interval [%]")
+            ("stats", po::value<string>(),
+                    "Publish live statistics in shared memory segment NAME");
+        break;
+    case stat:
+        desc_string =  "Usage:\n  swmr stat [options]\n\n"
+                       "    Display the live statistics of a running reader or writer\n\n"
+                       "Option Groups";
+        cmd_options_description.add_options()
+            ("stats", po::value<string>()->default_value("swmr"),
+                    "Name of the shared memory segment to attach to")
+            ("interval,i", po::value<double>()->default_value(1.0),
+                    "Display update interval [sec]")
+            ("count,n", po::value<int>()->default_value(-1),
+                    "Number of updates to display (-1: until publisher finishes)");
+        break;
+    case mdclog:
+        desc_string =  "Usage:\n  swmr mdclog [options] LOGFILE\n\n"
+                       "    Summarise a metadata cache log written with --mdc-log\n\n"
+                       "Option Groups";
+        cmd_options_description.add_options()
+            ("nframes,n", po::value<int>()->default_value(0),
+                    "Number of frames written or read while logging, for per frame counts")
+            ("spike", po::value<double>()->default_value(3.0),
+                    "List the seconds with this many times the median number of messages");
+        break;
+    case ringbench:
+        desc_string =  "Usage:\n  swmr ringbench [options]\n\n"
+                       "    Benchmark the hand-off of frames between threads through a frame ring\n\n"
+                       "Option Groups";
+        cmd_options_description.add_options()
+            ("nframes,n", po::value<int>()->default_value(100000),
+                    "Number of frames to hand off")
+            ("slots", po::value<int>()->default_value(64),
+                    "Number of slots in the ring (a power of two)")
+            ("frame-bytes", po::value<int>()->default_value(65536),
+                    "Size of the frame copied into each slot [bytes]")
+            ("producers", po::value<int>()->default_value(1),
+                    "Number of producer threads (more than one: MPSC ring)");
         break;
     }
 
@@ -170,6 +295,10 @@ void SwmrDemoCli::parse_options()
         notify(m_options);
 
         option_dependency(m_options, "testdataset", "testdata");
+        option_dependency(m_options, "burst", "rate");
+        option_dependency(m_options, "burst", "burst-period");
+        option_dependency(m_options, "burst-period", "burst");
+        option_dependency(m_options, "rt-priority", "realtime");
     }
     catch(exception& e) {
         LOG4CXX_ERROR(m_log, "Exception (rethrowing): " << e.what() );
@@ -179,6 +308,14 @@ void SwmrDemoCli::parse_options()
     if (m_options.count("logconfig")) {
         DOMConfigurator::configure(m_options["logconfig"].as<string>());
     }
+
+    if (m_options.count("tsc")) {
+        if (TimeStamp::enable_tsc()) {
+            LOG4CXX_INFO(m_log, "Timing with TSC at " << TimeStamp::tsc_ghz() << "GHz");
+        } else {
+            LOG4CXX_WARN(m_log, "No invariant TSC available. Timing with CLOCK_MONOTONIC");
+        }
+    }
 }
 
 void SwmrDemoCli::log_options()
@@ -213,7 +350,7 @@ int SwmrDemoCli::run()
 
     switch(m_subcmd) {
     case help:
-        cout << "Available subcommands: [help|read|write] " << endl;
+        cout << "Available subcommands: [help|read|write|stat|mdclog|ringbench] " << endl;
         cout << m_options_description << endl;
         ret = 0;
         break;
@@ -225,35 +362,116 @@ int SwmrDemoCli::run()
         LOG4CXX_DEBUG(m_log, "Writing...");
         this->run_write();
         break;
+    case stat:
+        ret = this->run_stat();
+        break;
+    case mdclog:
+        ret = this->run_mdclog();
+        break;
+    case ringbench:
+        ret = this->run_ringbench();
+        break;
     }
     return ret;
 }
 
+void SwmrDemoCli::configure_placement(const string& main_role)
+{
+    if (!m_options.count("cpu") && !m_options.count("numa-node")) return;
+    string cpus = m_options.count("cpu") ? m_options["cpu"].as<string>() : "";
+    int node = m_options.count("numa-node") ? m_options["numa-node"].as<int>() : -1;
+    if (m_options.count("numa-node") && node < 0) {
+        throw logic_error("Option 'numa-node' must not be negative");
+    }
+    // Before any frame buffers are allocated, so they are allocated on the node
+    CpuPlacement::configure(cpus, node);
+    CpuPlacement::pin_thread(main_role, 0);
+}
+
 int SwmrDemoCli::run_read()
 {
     string datafile(m_options["datafile"].as<string>());
     string dataset(m_options["dataset"].as<string>());
+    this->configure_placement("reader");
 
     LOG4CXX_DEBUG(m_log, "Creating a SWMR Reader object");
     SWMRReader srd;
 
+    srd.set_chunk_cache(m_options["cache-mb"].as<double>());
+    if (m_options["read-attempts"].as<int>() < 0) {
+        throw logic_error("Option 'read-attempts' must not be negative");
+    }
+    srd.set_metadata_read_attempts(m_options["read-attempts"].as<int>());
+    if (m_options.count("mdc-log")) srd.set_mdc_log(m_options["mdc-log"].as<string>());
+    srd.set_io_trace(m_options.count("trace-io") > 0);
     LOG4CXX_INFO(m_log, "Opening file (" << datafile << ")");
     srd.open_file(datafile, dataset);
 
+    if (m_options.count("stats")) {
+        srd.publish_stats(m_options["stats"].as<string>());
+    }
+
     LOG4CXX_DEBUG(m_log, "Getting test data");
     if (m_options.count("testdatafile")) {
         string testdatafile(m_options["testdatafile"].as<string>());
         string testdataset(m_options["testdataset"].as<string>());
-        srd.get_test_data(testdatafile, testdataset);
+        srd.get_test_data(testdatafile, testdataset,
+                          m_options.count("ref-cache") > 0);
     } else {
         srd.get_test_data();
     }
 
+    if (m_options.count("roi")) {
+        vector<string> roi_strings = m_options["roi"].as< vector<string> >();
+        vector<FrameRegion> rois;
+        for (size_t i = 0; i < roi_strings.size(); i++) {
+            FrameRegion roi;
+            char sep[3] = { 0, 0, 0 };
+            unsigned long long row, col, rows, cols;
+            istringstream iss(roi_strings[i]);
+            if (!(iss >> row >> sep[0] >> col >> sep[1] >> rows >> sep[2] >> cols)
+                || sep[0] != ',' || sep[1] != ',' || sep[2] != ',') {
+                throw logic_error("Invalid region of interest (expected ROW,COL,ROWS,COLS): "
+                                  + roi_strings[i]);
+            }
+            roi.row = row; roi.col = col; roi.rows = rows; roi.cols = cols;
+            rois.push_back(roi);
+        }
+        srd.set_rois(rois, m_options.count("roi-align") > 0);
+    }
+
+    if (m_options.count("frame-records")) {
+        if (m_options.count("preview")) {
+            throw logic_error("--frame-records can not be combined with --preview");
+        }
+        srd.open_frame_records();
+    }
+
     LOG4CXX_INFO(m_log, "Starting monitor");
     double polltime = m_options["polltime"].as<double>();
     double timeout = m_options["timeout"].as<double>();
     int expected_frames = m_options["nframes"].as<int>();
-    srd.monitor_dataset(timeout, polltime, expected_frames);
+    if (m_options.count("preview")) {
+        if (m_options.count("roi")) {
+            throw logic_error("--preview can not be combined with --roi");
+        }
+        double interval = m_options["preview"].as<double>();
+        int bin = m_options["bin"].as<int>();
+        if (interval <= 0. || bin < 1) {
+            throw logic_error("--preview must be positive and --bin at least 1");
+        }
+        srd.preview_dataset(interval, bin, timeout, expected_frames);
+    } else if (m_options["engine"].as<string>() == "h5ld") {
+        if (m_options.count("roi")) {
+            throw logic_error("--engine h5ld can not be combined with --roi");
+        }
+        srd.watch_dataset(timeout, polltime, expected_frames);
+    } else if (m_options["engine"].as<string>() == "latest") {
+        srd.monitor_dataset(timeout, polltime, expected_frames);
+    } else {
+        throw logic_error("Unknown reader engine: " + m_options["engine"].as<string>());
+    }
+    if (m_options.count("timestamps")) srd.analyse_frame_timestamps();
     int fail_count = srd.report();
     return fail_count;
 }
@@ -263,13 +481,36 @@ int SwmrDemoCli::run_write()
     string datafile(m_options["datafile"].as<string>());
     int niter = m_options["niter"].as<int>();
     int nchunked_frames = m_options["chunk"].as<int>();
+    this->configure_placement("writer loop");
 
     LOG4CXX_DEBUG(m_log, "Creating a SWMR Writer object (" << datafile << ")");
-    SWMRWriter swr = SWMRWriter(datafile);
+    SWMRWriter swr(datafile);
+
+    if (m_options.count("backing-store") && m_options["driver"].as<string>() != "core") {
+        throw logic_error("Option 'backing-store' requires '--driver core'");
+    }
+    swr.set_driver(parse_file_driver(m_options["driver"].as<string>()),
+                   m_options.count("backing-store") > 0);
+    if (m_options.count("trace-file") || !m_options["coalesce"].defaulted()) {
+        if (m_options["driver"].as<string>() != "trace") {
+            throw logic_error("Options 'trace-file' and 'coalesce' require '--driver trace'");
+        }
+        if (m_options["coalesce"].as<int>() < 0) {
+            throw logic_error("Option 'coalesce' must not be negative");
+        }
+    }
+    swr.set_io_trace(m_options.count("trace-file") ? m_options["trace-file"].as<string>() : "",
+                     m_options["coalesce"].as<int>());
+
+    if (m_options.count("mdc-log")) swr.set_mdc_log(m_options["mdc-log"].as<string>());
 
     LOG4CXX_DEBUG(m_log, "Creating file: "<< datafile);
     swr.create_file();
 
+    if (m_options.count("stats")) {
+        swr.publish_stats(m_options["stats"].as<string>());
+    }
+
     LOG4CXX_INFO(m_log, "Getting test data");
     if (m_options.count("testdatafile")) {
         string testdatafile(m_options["testdatafile"].as<string>());
@@ -279,7 +520,77 @@ int SwmrDemoCli::run_write()
         swr.get_test_data();
     }
 
-    LOG4CXX_INFO(m_log, "Writing 40 iterations");
+    swr.set_chunk_cache(m_options["cache-mb"].as<double>());
+
+    unsigned long long tile_rows = 0, tile_cols = 0;
+    if (m_options.count("tile")) {
+        string tile = m_options["tile"].as<string>();
+        char sep = 0;
+        istringstream iss(tile);
+        if (!(iss >> tile_rows >> sep >> tile_cols) || sep != 'x'
+            || tile_rows == 0 || tile_cols == 0) {
+            throw logic_error("Invalid tile shape (expected ROWSxCOLS): " + tile);
+        }
+    }
+    swr.set_tiling(tile_rows, tile_cols, m_options["tile-threads"].as<int>());
+
+    string chunk_index = m_options["chunk-index"].as<string>();
+    if (chunk_index == "earray") {
+        swr.set_chunk_index(H5D_CHUNK_IDX_EARRAY, m_options.count("dont-filter-partial-chunks") > 0);
+    } else if (chunk_index == "bt2") {
+        swr.set_chunk_index(H5D_CHUNK_IDX_BT2, m_options.count("dont-filter-partial-chunks") > 0);
+    } else {
+        throw logic_error("Unknown chunk index type: " + chunk_index);
+    }
+
+    if (m_options.count("frame-records")) {
+        int batch = m_options["frame-records"].as<int>();
+        if (batch <= 0) throw logic_error("Option 'frame-records' must be positive");
+        swr.set_frame_records(batch);
+    }
+
+    if (m_options.count("timestamps")) swr.set_frame_timestamps(true);
+
+    if (m_options.count("realtime")) {
+        int priority = m_options.count("rt-priority") ? m_options["rt-priority"].as<int>() : 0;
+        if (m_options.count("rt-priority") && (priority < 1 || priority > 99)) {
+            throw logic_error("Option 'rt-priority' must be between 1 and 99");
+        }
+        swr.set_realtime(true, priority);
+    }
+
+    if (m_options.count("flush-batch")) {
+        int flush_batch = m_options["flush-batch"].as<int>();
+        if (flush_batch <= 0) throw logic_error("Option 'flush-batch' must be positive");
+        swr.set_flush_batch(flush_batch);
+    }
+
+    if (m_options.count("rate")) {
+        double rate = m_options["rate"].as<double>();
+        if (rate <= 0.) throw logic_error("Option 'rate' must be positive");
+        int burst = 0;
+        double burst_period = 0.;
+        if (m_options.count("burst")) {
+            burst = m_options["burst"].as<int>();
+            burst_period = m_options["burst-period"].as<double>();
+            if (burst <= 0 || burst_period < burst / rate) {
+                throw logic_error("Option 'burst-period' must fit 'burst' frames at 'rate'");
+            }
+        }
+        swr.set_frame_rate(rate, burst, burst_period);
+    }
+
+    if (m_options.count("duration") || m_options.count("max-size")) {
+        double duration = m_options.count("duration") ? m_options["duration"].as<double>() : 0.;
+        double max_size = m_options.count("max-size") ? m_options["max-size"].as<double>() : 0.;
+        // In soak mode the number of iterations is only a limit if given explicitly
+        if (m_options["niter"].defaulted()) niter = 0;
+        swr.set_soak(duration, max_size,
+                     m_options["report-interval"].as<double>(),
+                     m_options["drift"].as<double>());
+    }
+
+    LOG4CXX_INFO(m_log, "Writing " << niter << " iterations");
     bool direct = m_options.count("direct") >= 1;
     swr.write_test_data(niter, nchunked_frames, direct);
 
@@ -287,6 +598,91 @@ int SwmrDemoCli::run_write()
     return 0;
 }
 
+int SwmrDemoCli::run_stat()
+{
+    string name(m_options["stats"].as<string>());
+    double interval = m_options["interval"].as<double>();
+    int count = m_options["count"].as<int>();
+
+    LOG4CXX_DEBUG(m_log, "Attaching to live statistics: " << name);
+    LiveStats stats;
+    stats.attach(name);
+
+    LiveStatsData data;
+    for (int i = 0; count < 0 || i < count; i++) {
+        if (i > 0) usleep((unsigned int) (interval * 1000000));
+        bool consistent = stats.snapshot(data);
+
+        uint64_t now_ns = TimeStamp::monotonic_now_ns();
+        bool alive = kill(data.pid, 0) == 0 || errno == EPERM;
+        if (!consistent) {
+            if (!alive) {
+                cout << "Publisher process " << data.pid << " is gone" << endl;
+                break;
+            }
+            cout << "Publisher process " << data.pid << " is stuck in an update" << endl;
+            continue;
+        }
+
+        cout << setw(8) << data.role << " [" << data.pid << "]"
+             << "  frames: " << setw(10) << data.frames
+             << fixed << setprecision(1)
+             << "  rate: " << setw(9) << data.rate << "Hz"
+             << "  latency: " << setw(9) << data.last_latency_ns / 1000. << "us"
+             << "  failures: " << data.failures
+             << "  elapsed: " << (data.update_ns - data.start_ns) / 1E9 << "s"
+             << "  age: " << (now_ns - data.update_ns) / 1E9 << "s" << endl;
+
+        if (data.state == LiveStatsData::finished) {
+            cout << "Publisher finished" << endl;
+            break;
+        }
+        if (!alive) {
+            cout << "Publisher process " << data.pid << " is gone" << endl;
+            break;
+        }
+    }
+    return 0;
+}
+
+int SwmrDemoCli::run_mdclog()
+{
+    if (m_options["datafile"].defaulted()) {
+        throw logic_error("No metadata cache log file given");
+    }
+    string logfile(m_options["datafile"].as<string>());
+    int nframes = m_options["nframes"].as<int>();
+
+    LOG4CXX_DEBUG(m_log, "Summarising metadata cache log: " << logfile);
+    ifstream is(logfile.c_str());
+    if (!is) throw runtime_error("Unable to open metadata cache log: " + logfile);
+    MdcLogSummary summary;
+    summary.parse(is);
+
+    cout << endl << "======= Metadata cache log: " << logfile << " ========" << endl << endl;
+    summary.print(cout, nframes > 0 ? nframes : 0, m_options["spike"].as<double>());
+    return 0;
+}
+
+int SwmrDemoCli::run_ringbench()
+{
+    int nframes = m_options["nframes"].as<int>();
+    int nslots = m_options["slots"].as<int>();
+    int frame_bytes = m_options["frame-bytes"].as<int>();
+    int nproducers = m_options["producers"].as<int>();
+    if (nframes <= 0 || nslots <= 0 || frame_bytes < 0 || nproducers <= 0) {
+        throw logic_error("ringbench options must be positive");
+    }
+    this->configure_placement("consumer");
+
+    LOG4CXX_DEBUG(m_log, "Frame ring benchmark: " << nframes << " frames");
+    RingBenchmark bench(nslots, frame_bytes, nproducers);
+    unsigned long long errors = bench.run(nframes);
+
+    cout << endl << "======= Frame ring benchmark ========" << endl << endl;
+    bench.print(cout);
+    return errors > 0 ? 1 : 0;
+}
 
 int main(int ac, char* av[])
 {
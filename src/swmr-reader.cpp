@@ -1,38 +1,80 @@
 #include <iostream>
+#include <iomanip>
 #include <vector>
 #include <algorithm>
+#include <stdexcept>
+#include <cstring>
 #include <assert.h>
 #include <unistd.h>
 
 #include <log4cxx/logger.h>
 using namespace log4cxx;
 
+#include "hdf5.h"
+#include "hdf5_hl.h"
 #include "swmr-testdata.h"
 #include "timestamp.h"
 #include "progressbar.h"
+#include "probe.h"
+#include "placement.h"
+#include "tracevfd.h"
 #include "swmr-reader.h"
 
 using namespace std;
 
+// Maximum number of frames read at once by the H5LD extent watcher
+static const hsize_t MAX_WATCH_FRAMES = 64;
+
+// Maximum number of per-frame records read at once
+static const hsize_t MAX_RECORDS_READ = 4096;
+
 SWMRReader::SWMRReader()
 {
     m_log = Logger::getLogger("SWMRReader");
     LOG4CXX_TRACE(m_log, "SWMRReader constructor");
     m_filename = "";
     m_fid = -1;
+    m_dapl = -1;
+    m_cache_mb = 0.0;
+    m_read_attempts = 0;
+    m_engine = "latest";
+    m_fetched_frames = 0;
+    m_records_dset = -1;
+    m_record_type = -1;
+    m_records_read = 0;
+    m_record_counts = 0;
+    m_record_errors = 0;
+    m_have_timeline = false;
     m_pdata = NULL;
     m_latest_framenumber = 0;
+    m_failed_checks = 0;
+    m_last_read_ns = 0;
+    m_preview_interval = 0.;
+    m_previews = 0;
+    m_preview_skipped = 0;
+    m_preview_secs = 0.;
 }
 
 SWMRReader::~SWMRReader()
 {
     LOG4CXX_TRACE(m_log, "SWMRReader destructor");
 
+    if (m_records_dset >= 0) {
+        assert(H5Dclose(m_records_dset) >= 0);
+        assert(H5Tclose(m_record_type) >= 0);
+        m_records_dset = -1;
+    }
+
     if (m_fid >= 0) {
         assert(H5Fclose(m_fid) >= 0);
         m_fid = -1;
     }
 
+    if (m_dapl >= 0) {
+        assert(H5Pclose(m_dapl) >= 0);
+        m_dapl = -1;
+    }
+
     if (m_pdata != NULL) {
         delete[] m_pdata;
         m_pdata = NULL;
@@ -52,10 +94,168 @@ void SWMRReader::open_file(const string& fname, const string& dsetname)
     assert(fapl >= 0);
     /* Set to use the latest library format */
     assert(H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST) >= 0);
+    /* Metadata reads which fail their checksum, because the writer is
+     * flushing that entry, are retried up to this many times */
+    if (m_read_attempts > 0) {
+        assert(H5Pset_metadata_read_attempts(fapl, m_read_attempts) >= 0);
+    }
+    if (!m_mdc_log.empty()) {
+        LOG4CXX_INFO(m_log, "Logging metadata cache operations to: " << m_mdc_log);
+        assert(H5Pset_mdc_log_options(fapl, true, m_mdc_log.c_str(), true) >= 0);
+    }
+    /* The trace driver counts the raw data I/O: the chunk cache misses */
+    if (m_cache_counters.traced) {
+        IoTrace::set_fapl(fapl, 0, false);
+    }
 
     m_fid = H5Fopen(m_filename.c_str(),
                     H5F_ACC_RDONLY | H5F_ACC_SWMR_READ, fapl);
     assert(m_fid >= 0);
+
+    this->configure_chunk_cache(false);
+    assert(H5Pclose(fapl) >= 0);
+    m_audit.baseline(m_fid);
+}
+
+void SWMRReader::open_frame_records()
+{
+    assert(m_fid >= 0);
+    if (H5Lexists(m_fid, FRAME_RECORDS_DSET, H5P_DEFAULT) <= 0) {
+        throw runtime_error("No per-frame records (" FRAME_RECORDS_DSET
+                            ") in " + m_filename);
+    }
+    m_records_dset = H5Dopen2(m_fid, FRAME_RECORDS_DSET, H5P_DEFAULT);
+    assert(m_records_dset >= 0);
+    m_record_type = create_frame_record_type();
+
+    /* Every frame has the reference pixel values */
+    const uint32_t * pdata = m_testimg.pdata();
+    hsize_t nitems = m_testimg.dimensions()[0] * m_testimg.dimensions()[1];
+    m_record_counts = 0;
+    for (hsize_t p = 0; p < nitems; p++) m_record_counts += pdata[p];
+
+    // The records dataset stays open
+    m_audit.baseline(m_fid);
+}
+
+void SWMRReader::read_frame_records()
+{
+    assert(H5Drefresh(m_records_dset) >= 0);
+    hid_t dspace = H5Dget_space(m_records_dset);
+    assert(dspace >= 0);
+    hsize_t nrecords = 0;
+    assert(H5Sget_simple_extent_dims(dspace, &nrecords, NULL) == 1);
+    if (nrecords > m_records_read) {
+        hsize_t offset = m_records_read;
+        hsize_t count = min<hsize_t>(nrecords - m_records_read, MAX_RECORDS_READ);
+        m_record_buf.resize(count);
+        assert(H5Sselect_hyperslab(dspace, H5S_SELECT_SET, &offset, NULL,
+                                   &count, NULL) >= 0);
+        hid_t memspace = H5Screate_simple(1, &count, NULL);
+        assert(memspace >= 0);
+        assert(H5Dread(m_records_dset, m_record_type, memspace, dspace,
+                       H5P_DEFAULT, &m_record_buf[0]) >= 0);
+        assert(H5Sclose(memspace) >= 0);
+
+        uint64_t now = TimeStamp::monotonic_now_ns();
+        for (hsize_t r = 0; r < count; r++) {
+            const FrameRecord& rec = m_record_buf[r];
+            if (rec.frame != offset + r || rec.counts != m_record_counts) {
+                LOG4CXX_WARN(m_log, "Frame record mismatch. Record = " << offset + r
+                             << " frame = " << rec.frame << " counts = " << rec.counts);
+                m_record_errors++;
+            }
+            m_record_age.record(now - rec.timestamp_ns);
+        }
+        m_records_read += count;
+    }
+    assert(H5Sclose(dspace) >= 0);
+}
+
+void SWMRReader::set_chunk_cache(double mbytes)
+{
+    m_cache_mb = mbytes;
+}
+
+void SWMRReader::set_metadata_read_attempts(unsigned int attempts)
+{
+    m_read_attempts = attempts;
+}
+
+void SWMRReader::set_mdc_log(const string& log_file)
+{
+    m_mdc_log = log_file;
+}
+
+void SWMRReader::set_io_trace(bool enable)
+{
+    m_cache_counters.traced = enable;
+}
+
+void SWMRReader::set_rois(const vector<FrameRegion>& rois, bool align)
+{
+    assert(m_testimg.dimensions().size() == 2);
+    hsize_t nrows = m_testimg.dimensions()[0];
+    hsize_t ncols = m_testimg.dimensions()[1];
+    m_rois.clear();
+    for (size_t i = 0; i < rois.size(); i++) {
+        FrameRegion roi = rois[i];
+        if (roi.rows == 0 || roi.cols == 0 ||
+            roi.row + roi.rows > nrows || roi.col + roi.cols > ncols) {
+            throw logic_error("Region of interest outside of the frame");
+        }
+        if (align) {
+            /* Expand to whole chunks, so no chunk is only partially read */
+            hsize_t row_end = roi.row + roi.rows;
+            hsize_t col_end = roi.col + roi.cols;
+            roi.row -= roi.row % m_chunk_dims[1];
+            roi.col -= roi.col % m_chunk_dims[2];
+            row_end = min(nrows, (row_end + m_chunk_dims[1] - 1) / m_chunk_dims[1] * m_chunk_dims[1]);
+            col_end = min(ncols, (col_end + m_chunk_dims[2] - 1) / m_chunk_dims[2] * m_chunk_dims[2]);
+            roi.rows = row_end - roi.row;
+            roi.cols = col_end - roi.col;
+        }
+        LOG4CXX_DEBUG(m_log, "Region of interest: offset = " << roi.row << ", "
+                      << roi.col << " size = " << roi.rows << ", " << roi.cols);
+        m_rois.push_back(roi);
+    }
+}
+
+void SWMRReader::configure_chunk_cache(bool keep_open)
+{
+    if (m_dapl >= 0) {
+        assert(H5Pclose(m_dapl) >= 0);
+        m_dapl = -1;
+    }
+    hid_t dset = H5Dopen2(m_fid, m_dsetname.c_str(), H5P_DEFAULT);
+    assert(dset >= 0);
+    hid_t dcpl = H5Dget_create_plist(dset);
+    assert(dcpl >= 0);
+    hsize_t * chunk_dims = m_chunk_dims;
+    assert(H5Pget_chunk(dcpl, 3, chunk_dims) == 3);
+    hid_t dspace = H5Dget_space(dset);
+    assert(dspace >= 0);
+    hsize_t dims[3];
+    assert(H5Sget_simple_extent_dims(dspace, dims, NULL) == 3);
+
+    /* When the dataset stays open between reads, hold the chunks of one
+     * frame; chunks which have been read completely are evicted first
+     * (w0=1). When it is opened for each read the cache would be dropped
+     * after every read, so keep it below a chunk: partial chunk reads then
+     * go straight to the file */
+    hsize_t frame_dims[2] = { dims[1], dims[2] };
+    m_cache_config = tune_chunk_cache(frame_dims, chunk_dims, sizeof(uint32_t),
+                                      keep_open ? 1 : 0, 1.0, m_cache_mb);
+    LOG4CXX_DEBUG(m_log, "Chunk cache nslots=" << m_cache_config.nslots
+                  << " nbytes=" << m_cache_config.nbytes);
+    m_dapl = H5Pcreate(H5P_DATASET_ACCESS);
+    assert(m_dapl >= 0);
+    assert(H5Pset_chunk_cache(m_dapl, m_cache_config.nslots, m_cache_config.nbytes,
+                              m_cache_config.w0) >= 0);
+
+    assert(H5Sclose(dspace) >= 0);
+    assert(H5Pclose(dcpl) >= 0);
+    assert(H5Dclose(dset) >= 0);
 }
 
 void SWMRReader::get_test_data()
@@ -68,25 +268,36 @@ void SWMRReader::get_test_data()
 
     // Allocate some space for our reading-in buffer
     m_pdata = m_testimg.create_buffer();
+    CpuPlacement::note_buffer("read buffer", m_pdata);
 }
 
-void SWMRReader::get_test_data(const string& fname, const string& dsetname)
+void SWMRReader::get_test_data(const string& fname, const string& dsetname,
+                               bool shared_cache)
 {
     LOG4CXX_DEBUG(m_log, "Getting test data from: " << fname << "/" << dsetname);
-    m_testimg = Frame(fname, dsetname);
+    if (shared_cache) {
+        m_testimg = m_refcache.load(fname, dsetname);
+        LOG4CXX_INFO(m_log, "Reference frame cache "
+                     << (m_refcache.hit() ? "hit" : "miss") << ": "
+                     << RefFrameCache::segment_name(fname, dsetname));
+    } else {
+        m_testimg = Frame(fname, dsetname);
+    }
 
     // Allocate some space for our reading-in buffer
     m_pdata = m_testimg.create_buffer();
+    CpuPlacement::note_buffer("read buffer", m_pdata);
 }
 
 unsigned long long SWMRReader::latest_frame_number()
 {
+    TimeStamp poll_ts;
     herr_t status;
     hid_t dset;
     // sanity check
     assert(m_dsetname != "");
     assert(m_fid >= 0);
-    dset = H5Dopen2(m_fid, m_dsetname.c_str(), H5P_DEFAULT);
+    dset = H5Dopen2(m_fid, m_dsetname.c_str(), m_dapl);
     assert(dset >= 0);
 
     /* Get the dataspace */
@@ -95,7 +306,13 @@ unsigned long long SWMRReader::latest_frame_number()
     assert(dspace >= 0);
 
     /* Refresh the dataset, i.e. get the latest info from disk */
-    assert(H5Drefresh(dset) >= 0);
+    {
+        SWMR_PROBE(PROBE_REFRESH);
+        TimeStamp refresh_ts;
+        status = H5Drefresh(dset);
+        m_refresh_latency.record(refresh_ts.nanoseconds_until_now());
+    }
+    assert(status >= 0);
 
     int ndims = H5Sget_simple_extent_ndims(dspace);
     assert(ndims == (1 + m_testimg.dimensions().size()));
@@ -114,17 +331,19 @@ unsigned long long SWMRReader::latest_frame_number()
     assert(H5Dclose(dset) >= 0);
     assert(H5Sclose(dspace) >= 0);
 
+    m_poll_latency.record(poll_ts.nanoseconds_until_now());
     return m_dims[0];
 }
 
 void SWMRReader::read_latest_frame()
 {
+    TimeStamp fetch_ts;
     herr_t status;
     hid_t dset;
     // sanity check
     assert(m_dsetname != "");
     assert(m_fid >= 0);
-    dset = H5Dopen2(m_fid, m_dsetname.c_str(), H5P_DEFAULT);
+    dset = H5Dopen2(m_fid, m_dsetname.c_str(), m_dapl);
     assert(dset >= 0);
 
     /* Get the dataspace */
@@ -135,31 +354,68 @@ void SWMRReader::read_latest_frame()
     hsize_t offset[3] = { m_dims[0] - 1, 0, 0 };
     assert(offset[0] >= 0);
     hsize_t img_size[3] = { 1, m_dims[1], m_dims[2] };
-    assert(H5Sselect_hyperslab(dspace, H5S_SELECT_SET, offset,
-                               NULL, img_size, NULL) >= 0);
-
     hid_t memspace;
-    memspace = H5Screate_simple(2, m_dims+1, NULL);
-    assert(memspace >= 0);
-    status = H5Sselect_hyperslab(memspace, H5S_SELECT_SET, offset+1,
-                                 NULL, img_size+1, NULL);
+    {
+        SWMR_PROBE(PROBE_SELECT);
+        memspace = H5Screate_simple(2, m_dims+1, NULL);
+        assert(memspace >= 0);
+        if (m_rois.empty()) {
+            assert(H5Sselect_hyperslab(dspace, H5S_SELECT_SET, offset,
+                                       NULL, img_size, NULL) >= 0);
+            status = H5Sselect_hyperslab(memspace, H5S_SELECT_SET, offset+1,
+                                         NULL, img_size+1, NULL);
+        } else {
+            /* Select the union of the regions of interest, at the same
+             * position in the file frame and the in-memory frame */
+            status = 0;
+            for (size_t i = 0; i < m_rois.size() && status >= 0; i++) {
+                H5S_seloper_t op = i == 0 ? H5S_SELECT_SET : H5S_SELECT_OR;
+                hsize_t roi_offset[3] = { offset[0], m_rois[i].row, m_rois[i].col };
+                hsize_t roi_size[3] = { 1, m_rois[i].rows, m_rois[i].cols };
+                assert(H5Sselect_hyperslab(dspace, op, roi_offset,
+                                           NULL, roi_size, NULL) >= 0);
+                status = H5Sselect_hyperslab(memspace, op, roi_offset+1,
+                                             NULL, roi_size+1, NULL);
+            }
+        }
+    }
     assert(status >= 0);
 
     LOG4CXX_DEBUG(m_log, "Reading dataset: size = "
                   << img_size[0] << ", " << img_size[1] << ", "<< img_size[2]
                   << " offset = "
                   << offset[0] << ", " << offset[1] << ", "<< offset[2]);
-    status = H5Dread(dset, H5T_NATIVE_UINT32,
-                     memspace, dspace, H5P_DEFAULT,
-                     static_cast<void*>(m_pdata));
+    uint64_t raw_io = m_cache_counters.traced ? IoTrace::raw_io_calls() : 0;
+    TimeStamp read_ts;
+    {
+        SWMR_PROBE(PROBE_READ);
+        status = H5Dread(dset, H5T_NATIVE_UINT32,
+                         memspace, dspace, H5P_DEFAULT,
+                         static_cast<void*>(m_pdata));
+    }
+    m_last_read_ns = read_ts.nanoseconds_until_now();
     assert(status >= 0);
+    if (m_cache_counters.traced) {
+        m_cache_counters.raw_io += IoTrace::raw_io_calls() - raw_io;
+    }
+    if (m_rois.empty()) {
+        m_cache_counters.accesses += chunks_in_region(m_chunk_dims, 0, 0, m_dims[1], m_dims[2]);
+    } else {
+        for (size_t i = 0; i < m_rois.size(); i++) {
+            m_cache_counters.accesses += chunks_in_region(m_chunk_dims,
+                                                          m_rois[i].row, m_rois[i].col,
+                                                          m_rois[i].rows, m_rois[i].cols);
+        }
+    }
     m_latest_framenumber = m_dims[0];
 
     // Cleanup
-    this->print_open_objects();
     assert(H5Dclose(dset) >= 0);
     assert(H5Sclose(dspace) >= 0);
     assert(H5Sclose(memspace) >= 0);
+    m_audit.tick("read_latest_frame");
+    m_fetch_latency.record(fetch_ts.nanoseconds_until_now());
+    m_fetched_frames++;
 }
 
 bool SWMRReader::check_dataset()
@@ -171,13 +427,29 @@ bool SWMRReader::check_dataset()
     assert(readimg.dimensions()[0] == m_dims[1]);
     assert(readimg.dimensions()[1] == m_dims[2]);
 
-    bool result = readimg == m_testimg;
+    bool result = true;
+    {
+        SWMR_PROBE(PROBE_VERIFY);
+        if (m_rois.empty()) {
+            result = readimg == m_testimg;
+        } else {
+            for (size_t i = 0; i < m_rois.size() && result; i++) {
+                result = m_testimg.region_equal(m_pdata, m_rois[i]);
+            }
+        }
+    }
     if (result != true) {
         LOG4CXX_WARN(m_log, "Data mismatch. Frame = " << m_latest_framenumber);
     }
     return result;
 }
 
+void SWMRReader::publish_stats(const string& name)
+{
+    LOG4CXX_DEBUG(m_log, "Publishing live statistics in shared memory: " << name);
+    m_stats.publish(name, "reader");
+}
+
 void SWMRReader::monitor_dataset(double timeout, double polltime, int expected)
 {
     bool carryon = true;
@@ -186,13 +458,17 @@ void SWMRReader::monitor_dataset(double timeout, double polltime, int expected)
     TimeStamp ts;
 
     bool show_pbar = not m_log->isDebugEnabled();
+    ProgressBar pbar(expected > 0 ? expected : 0, show_pbar && expected > 0);
     while (carryon) {
+        if (m_records_dset >= 0) this->read_frame_records();
         if (this->latest_frame_number() > m_latest_framenumber) {
             this->read_latest_frame();
             check_result = this->check_dataset();
             m_checks.push_back(check_result);
+            if (!check_result) m_failed_checks++;
+            m_stats.update(m_checks.size(), m_last_read_ns, m_failed_checks);
             if (expected > 0) {
-                if (show_pbar) progressbar(this->m_latest_framenumber, expected);
+                pbar.update(this->m_latest_framenumber);
                 if (m_latest_framenumber >= expected) carryon = false;
             }
             ts.reset();
@@ -207,13 +483,214 @@ void SWMRReader::monitor_dataset(double timeout, double polltime, int expected)
             }
         }
     }
+    if (m_records_dset >= 0) this->read_frame_records();
+    m_audit.check("monitor_dataset");
+    m_stats.finish();
+}
+
+void SWMRReader::watch_dataset(double timeout, double polltime, int expected)
+{
+    /* Alternative to latest_frame_number() + read_latest_frame(): keep the
+     * dataset open, find the new extent with H5LDget_dset_dims() and read
+     * every frame appended since the last poll with H5LDget_dset_elmts() */
+    LOG4CXX_DEBUG(m_log, "Starting H5LD extent watcher");
+    m_engine = "h5ld";
+    this->configure_chunk_cache(true);
+    hid_t dset = H5Dopen2(m_fid, m_dsetname.c_str(), m_dapl);
+    assert(dset >= 0);
+    hsize_t nrows = m_testimg.dimensions()[0];
+    hsize_t ncols = m_testimg.dimensions()[1];
+    size_t frame_items = nrows * ncols;
+    hsize_t prev_dims[3] = { 0, nrows, ncols };
+    hsize_t cur_dims[3];
+    vector<uint32_t> buf;
+
+    bool carryon = true;
+    TimeStamp ts;
+    bool show_pbar = not m_log->isDebugEnabled();
+    ProgressBar pbar(expected > 0 ? expected : 0, show_pbar && expected > 0);
+    while (carryon) {
+        if (m_records_dset >= 0) this->read_frame_records();
+        herr_t poll_status;
+        {
+            SWMR_PROBE(PROBE_REFRESH);
+            TimeStamp poll_ts;
+            TimeStamp refresh_ts;
+            poll_status = H5Drefresh(dset);
+            m_refresh_latency.record(refresh_ts.nanoseconds_until_now());
+            if (poll_status >= 0) poll_status = H5LDget_dset_dims(dset, cur_dims);
+            m_poll_latency.record(poll_ts.nanoseconds_until_now());
+        }
+        assert(poll_status >= 0);
+        assert(cur_dims[1] == nrows && cur_dims[2] == ncols);
+        if (cur_dims[0] > prev_dims[0]) {
+            /* Bound the buffer if the reader has fallen far behind */
+            cur_dims[0] = min<hsize_t>(cur_dims[0], prev_dims[0] + MAX_WATCH_FRAMES);
+            hsize_t nnew = cur_dims[0] - prev_dims[0];
+            LOG4CXX_DEBUG(m_log, "Reading frames " << prev_dims[0] << " to " << cur_dims[0]);
+            buf.resize(nnew * frame_items);
+            uint64_t raw_io = m_cache_counters.traced ? IoTrace::raw_io_calls() : 0;
+            TimeStamp fetch_ts;
+            herr_t status;
+            {
+                SWMR_PROBE(PROBE_READ);
+                status = H5LDget_dset_elmts(dset, prev_dims, cur_dims, NULL, &buf[0]);
+            }
+            m_last_read_ns = fetch_ts.nanoseconds_until_now();
+            m_fetch_latency.record(m_last_read_ns);
+            assert(status >= 0);
+            if (m_cache_counters.traced) {
+                m_cache_counters.raw_io += IoTrace::raw_io_calls() - raw_io;
+            }
+            /* Every tile of each chunk slab the new frames fall in */
+            hsize_t nslabs = (cur_dims[0] - 1) / m_chunk_dims[0] - prev_dims[0] / m_chunk_dims[0] + 1;
+            m_cache_counters.accesses += nslabs * chunks_in_region(m_chunk_dims, 0, 0, nrows, ncols);
+            m_fetched_frames += nnew;
+
+            for (hsize_t f = 0; f < nnew; f++) {
+                bool check_result;
+                {
+                    SWMR_PROBE(PROBE_VERIFY);
+                    check_result = memcmp(&buf[f * frame_items], m_testimg.pdata(),
+                                          frame_items * sizeof(uint32_t)) == 0;
+                }
+                if (!check_result) {
+                    LOG4CXX_WARN(m_log, "Data mismatch. Frame = " << prev_dims[0] + f + 1);
+                    m_failed_checks++;
+                }
+                m_checks.push_back(check_result);
+            }
+            prev_dims[0] = cur_dims[0];
+            m_latest_framenumber = cur_dims[0];
+            m_stats.update(m_checks.size(), m_last_read_ns, m_failed_checks);
+            if (expected > 0) {
+                pbar.update(this->m_latest_framenumber);
+                if (m_latest_framenumber >= static_cast<unsigned long long>(expected)) carryon = false;
+            }
+            ts.reset();
+        } else {
+            double secs = ts.seconds_until_now();
+            if (timeout > 0 && secs > timeout) {
+                LOG4CXX_WARN(m_log, "Timeout: it's been " << secs
+                             << " seconds since last read");
+                carryon = false;
+            } else {
+                usleep((unsigned int) (polltime * 1000000));
+            }
+        }
+    }
+    assert(H5Dclose(dset) >= 0);
+    if (m_records_dset >= 0) this->read_frame_records();
+    m_audit.check("watch_dataset");
+    m_stats.finish();
 }
 
+void SWMRReader::preview_dataset(double interval, unsigned int bin,
+                                 double timeout, int expected)
+{
+    assert(interval > 0.);
+    hsize_t nrows = m_testimg.dimensions()[0];
+    hsize_t ncols = m_testimg.dimensions()[1];
+    if (bin < 1 || bin > nrows || bin > ncols) {
+        throw logic_error("Preview bin size must be between 1 and the frame size");
+    }
+    m_binner.configure(nrows, ncols, bin);
+    m_preview.assign(m_binner.out_items(), 0);
+    m_preview_ref.assign(m_binner.out_items(), 0);
+    m_binner.bin(m_testimg.pdata(), &m_preview_ref[0]);
+    m_preview_interval = interval;
+    LOG4CXX_DEBUG(m_log, "Starting preview: interval = " << interval
+                  << "s preview = " << m_binner.out_rows() << "x" << m_binner.out_cols());
+
+    /* At most one frame is read per display interval, and it is always the
+     * latest one, so the reader never builds up a backlog whatever the
+     * writer rate. Deadlines which have been missed are dropped, not caught
+     * up with. */
+    uint64_t interval_ns = static_cast<uint64_t>(interval * 1E9);
+    uint64_t deadline = TimeStamp::now_ns();
+    bool carryon = true;
+    TimeStamp ts;
+    TimeStamp first;                  // the first preview
+    bool show_pbar = not m_log->isDebugEnabled();
+    ProgressBar pbar(expected > 0 ? expected : 0, show_pbar && expected > 0);
+    while (carryon) {
+        uint64_t now = TimeStamp::now_ns();
+        if (now < deadline) {
+            usleep((unsigned int) ((deadline - now) / 1000));
+            now = TimeStamp::now_ns();
+        }
+        deadline += interval_ns;
+        if (deadline < now) deadline = now + interval_ns;
+
+        unsigned long long latest = this->latest_frame_number();
+        if (latest > m_latest_framenumber) {
+            m_preview_skipped += latest - m_latest_framenumber - 1;
+            this->read_latest_frame();
+            TimeStamp bin_ts;
+            m_binner.bin(m_pdata, &m_preview[0]);
+            m_bin_latency.record(bin_ts.nanoseconds_until_now());
+            /* The rate is measured between the first and the last preview,
+             * not over the idle time before the timeout */
+            if (m_previews == 0) first.reset();
+            m_preview_secs = first.seconds_until_now();
+            m_previews++;
+            bool check_result = m_preview == m_preview_ref;
+            if (!check_result) {
+                LOG4CXX_WARN(m_log, "Preview mismatch. Frame = " << m_latest_framenumber);
+            }
+            m_checks.push_back(check_result);
+            if (!check_result) m_failed_checks++;
+            m_stats.update(m_checks.size(), m_last_read_ns, m_failed_checks);
+            if (expected > 0) {
+                pbar.update(this->m_latest_framenumber);
+                if (m_latest_framenumber >= static_cast<unsigned long long>(expected)) carryon = false;
+            }
+            ts.reset();
+        } else {
+            double secs = ts.seconds_until_now();
+            if (timeout > 0 && secs > timeout) {
+                LOG4CXX_WARN(m_log, "Timeout: it's been " << secs
+                             << " seconds since last read");
+                carryon = false;
+            }
+        }
+    }
+    m_audit.check("preview_dataset");
+    m_stats.finish();
+}
+
+
+void SWMRReader::analyse_frame_timestamps()
+{
+    assert(m_fid >= 0);
+    if (H5Lexists(m_fid, FRAME_TIMESTAMPS_DSET, H5P_DEFAULT) <= 0) {
+        throw runtime_error("No frame timestamps (" FRAME_TIMESTAMPS_DSET
+                            ") in " + m_filename);
+    }
+    hid_t dset = H5Dopen2(m_fid, FRAME_TIMESTAMPS_DSET, H5P_DEFAULT);
+    assert(dset >= 0);
+    assert(H5Drefresh(dset) >= 0);
+    hid_t dspace = H5Dget_space(dset);
+    assert(dspace >= 0);
+    hsize_t n = 0;
+    assert(H5Sget_simple_extent_dims(dspace, &n, NULL) == 1);
+    vector<uint64_t> timestamps(n);
+    if (n > 0) {
+        assert(H5Dread(dset, H5T_NATIVE_UINT64, H5S_ALL, H5S_ALL,
+                       H5P_DEFAULT, &timestamps[0]) >= 0);
+    }
+    assert(H5Sclose(dspace) >= 0);
+    assert(H5Dclose(dset) >= 0);
+    LOG4CXX_DEBUG(m_log, "Read " << n << " frame timestamps");
+
+    m_timeline.analyse(timestamps);
+    m_have_timeline = true;
+}
 
 int SWMRReader::report()
 {
     ostringstream oss;
-    int fail_count = count(m_checks.begin(), m_checks.end(), false);
+    int fail_count = count(m_checks.begin(), m_checks.end(), false) + m_record_errors;
     oss << endl << "======= SWMR reader report ========" << endl << endl
         << " Number of checks: " << m_checks.size() << endl
         << " Number of frames: " << m_latest_framenumber << endl;
@@ -222,19 +699,120 @@ int SWMRReader::report()
     } else {
         oss << " Result: Failed checks: " << fail_count << endl;
     }
+    if (!m_rois.empty()) {
+        double roi_pixels = 0.;
+        for (size_t i = 0; i < m_rois.size(); i++) {
+            roi_pixels += m_rois[i].rows * m_rois[i].cols;
+        }
+        double frame_pixels = m_testimg.dimensions()[0] * m_testimg.dimensions()[1];
+        oss << " Regions of interest: " << m_rois.size() << " ("
+            << fixed << setprecision(1) << 100. * roi_pixels / frame_pixels
+            << "% of frame, overlaps counted twice)" << endl;
+    }
+    if (m_previews > 0) {
+        oss << " Preview: " << m_binner.out_rows() << "x" << m_binner.out_cols()
+            << " every " << fixed << setprecision(3) << m_preview_interval << "s" << endl
+            << " Previews shown: " << m_previews << " (" << setprecision(1)
+            << (m_preview_secs > 0. ? (m_previews - 1) / m_preview_secs : 0.)
+            << " Hz, target " << 1.0 / m_preview_interval << " Hz)" << endl
+            << " Frames skipped: " << m_preview_skipped << endl;
+        LatencyHistogram::print_header(oss);
+        m_bin_latency.print(oss, "bin");
+    }
+    if (m_records_dset >= 0) {
+        oss << " Frame records: " << m_records_read << " read, "
+            << m_record_errors << " mismatches" << endl;
+    }
+    oss << endl
+        << " Reader engine: " << m_engine;
+    if (m_fetch_latency.count() > 0) {
+        oss << " (" << fixed << setprecision(2)
+            << double(m_fetched_frames) / m_fetch_latency.count() << " frames per read)";
+    }
+    oss << endl;
+    LatencyHistogram::print_header(oss);
+    m_poll_latency.print(oss, "poll:");
+    m_fetch_latency.print(oss, "read:");
+    if (m_records_dset >= 0) m_record_age.print(oss, "record age:");
+    oss << endl;
+    if (m_have_timeline) {
+        m_timeline.print(oss);
+        oss << endl;
+    }
+    if (CpuPlacement::enabled()) {
+        CpuPlacement::print(oss);
+        oss << endl;
+    }
+    if (m_cache_counters.traced) {
+        IoTrace::print(oss, m_fetched_frames);
+        oss << endl;
+    }
+    this->print_read_retries(oss);
+    oss << endl;
+    print_chunk_cache(oss, m_cache_config, m_cache_counters);
+    double mdc_hit_rate = 0.;
+    if (m_fid >= 0 && H5Fget_mdc_hit_rate(m_fid, &mdc_hit_rate) >= 0) {
+        oss << " Metadata cache hit rate: " << fixed << setprecision(1)
+            << 100.0 * mdc_hit_rate << "%" << endl;
+    }
+#ifdef SWMR_ENABLE_PROBES
+    oss << endl;
+    Probes::print(oss);
+#endif
     if (not m_log->isDebugEnabled()) cout << oss.str();
     LOG4CXX_DEBUG(m_log, oss.str());
     return fail_count;
 }
 
-
-void SWMRReader::print_open_objects()
+void SWMRReader::print_read_retries(ostream& os)
 {
-    LOG4CXX_TRACE(m_log, "    DataSets open:    " << H5Fget_obj_count( m_fid, H5F_OBJ_DATASET ));
-    LOG4CXX_TRACE(m_log, "    Groups open:      " << H5Fget_obj_count( m_fid, H5F_OBJ_GROUP ));
-    LOG4CXX_TRACE(m_log, "    Attributes open:  " << H5Fget_obj_count( m_fid, H5F_OBJ_ATTR ));
-    LOG4CXX_TRACE(m_log, "    Datatypes open:   " << H5Fget_obj_count( m_fid, H5F_OBJ_DATATYPE ));
-    LOG4CXX_TRACE(m_log, "    Files open:       " << H5Fget_obj_count( m_fid, H5F_OBJ_FILE ));
-    LOG4CXX_TRACE(m_log, "    Sum objects open: " << H5Fget_obj_count( m_fid, H5F_OBJ_ALL ));
+    /* Order of H5F_retry_info_t::retries[], as documented for
+     * H5Fget_metadata_read_retry_info() */
+    static const char * entry_names[H5F_NUM_METADATA_READ_RETRY_TYPES] = {
+        "object header", "object header chunk", "v2 B-tree header",
+        "v2 B-tree internal", "v2 B-tree leaf", "fractal heap header",
+        "fractal heap direct", "fractal heap indirect", "free-space header",
+        "free-space sections", "SOHM table", "SOHM list",
+        "earray header", "earray index block", "earray super block",
+        "earray data block", "earray data page", "farray header",
+        "farray data block", "farray data page", "superblock"
+    };
+    os << " Metadata read attempts: ";
+    if (m_fid >= 0) {
+        hid_t fapl = H5Fget_access_plist(m_fid);
+        assert(fapl >= 0);
+        unsigned int attempts = 0;
+        assert(H5Pget_metadata_read_attempts(fapl, &attempts) >= 0);
+        assert(H5Pclose(fapl) >= 0);
+        os << attempts;
+    }
+    os << (m_read_attempts > 0 ? "" : " (library default)") << endl;
+    LatencyHistogram::print_header(os);
+    m_refresh_latency.print(os, "H5Drefresh:");
+    if (m_fid < 0) return;
+
+    H5F_retry_info_t info;
+    assert(H5Fget_metadata_read_retry_info(m_fid, &info) >= 0);
+    bool any = false;
+    for (int i = 0; i < H5F_NUM_METADATA_READ_RETRY_TYPES; i++) {
+        if (info.retries[i] == NULL) continue;
+        if (!any) {
+            /* Bin j counts the reads which needed 10^j to 10^(j+1)-1 retries */
+            os << " Metadata read retries:";
+            for (unsigned int j = 0, lo = 1; j < info.nbins; j++, lo *= 10) {
+                ostringstream bin;
+                bin << lo << "-" << lo * 10 - 1;
+                os << setw(10) << bin.str();
+            }
+            os << endl;
+            any = true;
+        }
+        os << setw(23) << string(entry_names[i]) + ":";
+        for (unsigned int j = 0; j < info.nbins; j++) {
+            os << setw(10) << info.retries[i][j];
+        }
+        os << endl;
+        H5free_memory(info.retries[i]);
+    }
+    if (!any) os << " Metadata read retries: none" << endl;
 }
-
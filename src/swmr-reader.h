@@ -9,38 +9,101 @@
 #define SWMR_READER_H_
 
 #include <string>
+#include <vector>
 #include <log4cxx/logger.h>
 #include <hdf5.h>
 
 #include "frame.h"
+#include "livestats.h"
+#include "chunkcache.h"
+#include "binning.h"
+#include "histogram.h"
+#include "refcache.h"
+#include "objaudit.h"
+#include "framerecord.h"
+#include "frametimeline.h"
 
 class SWMRReader {
 public:
     SWMRReader();
     ~SWMRReader();
+    void set_chunk_cache(double mbytes);
+    void set_metadata_read_attempts(unsigned int attempts);
+    void set_mdc_log(const std::string& log_file);
+    void set_io_trace(bool enable);
+    void set_rois(const std::vector<FrameRegion>& rois, bool align);
     void open_file(const std::string& fname, const std::string& dsetname);
+    void open_frame_records();
     void get_test_data();
-    void get_test_data(const std::string& fname, const std::string& dsetname);
+    void get_test_data(const std::string& fname, const std::string& dsetname,
+                       bool shared_cache = false);
     unsigned long long latest_frame_number();
     void read_latest_frame();
     bool check_dataset();
+    void publish_stats(const std::string& name);
     void monitor_dataset(double timeout = 2.0, double polltime=0.2, int expected=-1);
+    void watch_dataset(double timeout = 2.0, double polltime=0.2, int expected=-1);
+    void preview_dataset(double interval, unsigned int bin,
+                         double timeout = 2.0, int expected=-1);
+    void analyse_frame_timestamps();
     int report();
 
 private:
-    void print_open_objects();
+    void configure_chunk_cache(bool keep_open);
+    void print_read_retries(std::ostream& os);
+    void read_frame_records();
 
     LoggerPtr m_log;
     std::string m_filename;
     std::string m_dsetname;
     hid_t m_fid;
+    hid_t m_dapl;
+    double m_cache_mb;
+    unsigned int m_read_attempts;              // 0: library default
+    std::string m_mdc_log;                     // empty: no cache logging
+    LatencyHistogram m_refresh_latency;
+    std::string m_engine;                      // how new frames are found and read
+    LatencyHistogram m_poll_latency;           // finding out whether there are new frames
+    LatencyHistogram m_fetch_latency;          // reading them
+    unsigned long long m_fetched_frames;
+
+    // Per-frame records from the writer's packet table
+    hid_t m_records_dset;
+    hid_t m_record_type;
+    hsize_t m_records_read;
+    uint64_t m_record_counts;                  // expected FrameRecord::counts
+    unsigned long long m_record_errors;
+    std::vector<FrameRecord> m_record_buf;
+    LatencyHistogram m_record_age;             // write to read
+    bool m_have_timeline;
+    FrameTimeline m_timeline;                  // from the writer's frame timestamps
+
+    ChunkCacheConfig m_cache_config;
+    ChunkCacheCounters m_cache_counters;
+    hsize_t m_chunk_dims[3];
+    std::vector<FrameRegion> m_rois;           // empty: read full frames
     hsize_t m_dims[3];
     hsize_t m_maxdims[3];
 
+    RefFrameCache m_refcache;
     Frame m_testimg;
     uint32_t * m_pdata;
     unsigned long long m_latest_framenumber;
     std::vector<bool> m_checks;
+    unsigned long long m_failed_checks;
+    uint64_t m_last_read_ns;
+    LiveStats m_stats;
+    ObjectAudit m_audit;
+
+    // Live preview mode
+    FrameBinner m_binner;
+    std::vector<uint32_t> m_preview;
+    std::vector<uint32_t> m_preview_ref;
+    double m_preview_interval;
+    unsigned long long m_previews;
+    unsigned long long m_preview_skipped;   // frames never shown
+    double m_preview_secs;                  // first to last preview
+    LatencyHistogram m_bin_latency;
 };
 
 #endif /* SWMR_READER_H_ */
@@ -1,8 +1,10 @@
 #include <iostream>
+#include <iomanip>
 #include <string>
 #include <cmath>
 #include <numeric>
 #include <algorithm>
+#include <stdexcept>
 #include <assert.h>
 
 #include <cstdlib>
@@ -15,10 +17,25 @@ using namespace log4cxx;
 #include "timestamp.h"
 #include "swmr-testdata.h"
 #include "progressbar.h"
+#include "probe.h"
+#include "tracevfd.h"
+#include "placement.h"
 #include "swmr-writer.h"
 
 using namespace std;
 
+// Frame timestamps per chunk of the timestamps dataset (8KiB)
+static const hsize_t TIMESTAMPS_CHUNK = 1024;
+
+/* Let an object's metadata out of the cache, or hold it there */
+static void set_mdc_flushes(hid_t object, bool enable)
+{
+    herr_t status = enable ? H5Oenable_mdc_flushes(object) : H5Odisable_mdc_flushes(object);
+    if (status < 0) {
+        throw runtime_error(enable ? "Unable to enable metadata cache flushes"
+                                   : "Unable to disable metadata cache flushes");
+    }
+}
 
 SWMRWriter::SWMRWriter(const string& fname)
 {
@@ -27,8 +44,36 @@ SWMRWriter::SWMRWriter(const string& fname)
     LOG4CXX_TRACE(log, "SWMRWriter constructor. Filename: " << fname);
     this->filename = fname;
     this->fid = -1;
+    driver = DRIVER_SEC2;
+    backing_store = false;
+    trace_coalesce = 0;
+    flush_batch = 0;
+    record_batch = 0;
+    exposure = 0.0;
+    record_table = -1;
+    record_dset = -1;
+    frame_timestamps = false;
+    timestamps_dset = -1;
+    timestamps_written = 0;
+    image_dataset = -1;
+    last_object_flush_ns = 0;
     dt_start = 0.0;
+    chunks_per_frame = 0;
+    nwrites = 0;
+    write_time_sum = 0.0;
+    write_time_sq_sum = 0.0;
+    write_time_min = 0.0;
+    write_time_max = 0.0;
     nframes = 0;
+    soak_duration = 0.0;
+    soak_max_mb = 0.0;
+    chunk_index = H5D_CHUNK_IDX_EARRAY;
+    chunk_opts = 0;
+    cache_mb = 0.0;
+    direct_write = false;
+    tile_dims[0] = 0;
+    tile_dims[1] = 0;
+    tile_threads = 1;
 }
 
 void SWMRWriter::create_file()
@@ -42,12 +87,30 @@ void SWMRWriter::create_file()
 
     assert(H5Pset_fclose_degree(fapl, H5F_CLOSE_STRONG) >= 0);
 
+    LOG4CXX_DEBUG(log, "File driver: " << file_driver_name(driver));
+    if (driver == DRIVER_TRACE) {
+        IoTrace::set_fapl(fapl, trace_coalesce, !trace_file.empty());
+    } else {
+        set_fapl_driver(fapl, driver, backing_store);
+    }
+
     /* Set chunk boundary alignment to 4MB */
     assert( H5Pset_alignment( fapl, 65536, 4*1024*1024 ) >= 0);
 
     /* Set to use the latest library format */
     assert(H5Pset_libver_bounds(fapl, H5F_LIBVER_LATEST, H5F_LIBVER_LATEST) >= 0);
 
+    /* Time the interval between object flushes, i.e. how often readers
+     * can see new frames */
+    if (H5Pset_object_flush_cb(fapl, SWMRWriter::object_flush_cb, this) < 0) {
+        throw runtime_error("Unable to set the object flush callback");
+    }
+
+    if (!mdc_log.empty()) {
+        LOG4CXX_INFO(log, "Logging metadata cache operations to: " << mdc_log);
+        assert(H5Pset_mdc_log_options(fapl, true, mdc_log.c_str(), true) >= 0);
+    }
+
     /* Create file creation property list */
     if ((fcpl = H5Pcreate(H5P_FILE_CREATE)) < 0)
     assert(fcpl >= 0);
@@ -93,13 +156,22 @@ void SWMRWriter::write_test_data(unsigned int niter,
     hsize_t size[3];
 
     assert(this->img.dimensions().size() == 2);
+    CpuPlacement::note_buffer("frame buffer", this->img.pdata());
+    direct_write = direct;
     chunk_dims[0] = nframes_cache;
-    chunk_dims[1] = this->img.chunks()[0];
-    chunk_dims[2] = this->img.chunks()[1];
+    chunk_dims[1] = tile_dims[0] > 0 ? tile_dims[0] : this->img.chunks()[0];
+    chunk_dims[2] = tile_dims[1] > 0 ? tile_dims[1] : this->img.chunks()[1];
 
     max_dims[0] = H5S_UNLIMITED;
     max_dims[1] = this->img.dimensions()[0];
     max_dims[2] = this->img.dimensions()[1];
+    if (chunk_index == H5D_CHUNK_IDX_BT2) {
+        /* With the latest file format, more than one unlimited dimension
+         * makes the library index the chunks with a v2 B-tree rather than
+         * an extensible array */
+        max_dims[1] = H5S_UNLIMITED;
+        max_dims[2] = H5S_UNLIMITED;
+    }
 
     img_dims[0] = 1;
     img_dims[1] = this->img.dimensions()[0];
@@ -108,10 +180,12 @@ void SWMRWriter::write_test_data(unsigned int niter,
     size[1] = this->img.dimensions()[0];
     size[2] = this->img.dimensions()[1];
 
+    /* Frames between flushes: a chunk, or a batch of appends */
+    unsigned int flush_every = flush_batch > 0 ? flush_batch : nframes_cache;
     double full_cache_size = sizeof(uint32_t) *
                              this->img.dimensions()[0] *
                              this->img.dimensions()[1] *
-                             nframes_cache;
+                             flush_every;
     full_cache_size = full_cache_size / (1024. * 1024.); // in MegaBytes
 
     /* Create the dataspace with the given dimensions - and max dimensions */
@@ -125,76 +199,243 @@ void SWMRWriter::write_test_data(unsigned int niter,
     prop = H5Pcreate(H5P_DATASET_CREATE);
     status = H5Pset_chunk(prop, 3, chunk_dims);
     assert(status >= 0);
+    if (chunk_opts != 0) {
+        LOG4CXX_DEBUG(log, "Chunk options=" << chunk_opts);
+        assert(H5Pset_chunk_opts(prop, chunk_opts) >= 0);
+    }
+    LOG4CXX_INFO(log, "Chunk index: " << SWMRWriter::chunk_index_name(chunk_index));
 
     /* dataset access property list */
     hid_t dapl = H5Pcreate(H5P_DATASET_ACCESS);
-    size_t nbytes = img_dims[1] * img_dims[2] * sizeof(uint32_t) * chunk_dims[0];
-    size_t nslots = static_cast<size_t>(ceil((double)max_dims[1] / chunk_dims[1]) * niter);
-    nslots *= 13;
-    LOG4CXX_DEBUG(log, "Chunk cache nslots=" << nslots << " nbytes=" << nbytes);
-    assert( H5Pset_chunk_cache( dapl, nslots, nbytes, 1.0) >= 0);
+    /* Size the chunk cache to hold the chunks of the slab being written.
+     * Fully written chunks are evicted first (w0=1.0) */
+    hsize_t frame_dims[2] = { img_dims[1], img_dims[2] };
+    cache_config = tune_chunk_cache(frame_dims, chunk_dims, sizeof(uint32_t),
+                                    1, 1.0, cache_mb);
+    chunks_per_frame = chunks_in_region(chunk_dims, 0, 0, frame_dims[0], frame_dims[1]);
+    LOG4CXX_DEBUG(log, "Chunk cache nslots=" << cache_config.nslots
+                  << " nbytes=" << cache_config.nbytes);
+    assert( H5Pset_chunk_cache( dapl, cache_config.nslots, cache_config.nbytes,
+                                cache_config.w0) >= 0);
 
     /* Create dataset  */
     LOG4CXX_DEBUG(log, "Creating dataset");
     dataset = H5Dcreate2(this->fid, "data", H5T_NATIVE_UINT32, dataspace,
     H5P_DEFAULT, prop, dapl);
+    image_dataset = dataset;
+
+    /* Per-frame records: a packet table with a batch of records per chunk.
+     * Objects can not be created once in SWMR mode, so create it now. */
+    uint64_t frame_counts = 0;
+    if (record_batch > 0) {
+        LOG4CXX_DEBUG(log, "Creating packet table: " << FRAME_RECORDS_DSET);
+        hid_t record_type = create_frame_record_type();
+        record_table = H5PTcreate_fl(this->fid, FRAME_RECORDS_DSET, record_type,
+                                     record_batch, -1);
+        assert(record_table >= 0);
+        assert(H5Tclose(record_type) >= 0);
+        record_dset = H5Dopen2(this->fid, FRAME_RECORDS_DSET, H5P_DEFAULT);
+        assert(record_dset >= 0);
+        records.reserve(record_batch);
+        const uint32_t * pdata = this->img.pdata();
+        for (size_t p = 0; p < this->img.num_bytes_img() / sizeof(uint32_t); p++) {
+            frame_counts += pdata[p];
+        }
+    }
+
+    /* Frame timestamps: a 1D dataset which grows with the image dataset */
+    if (frame_timestamps) {
+        LOG4CXX_DEBUG(log, "Creating dataset: " << FRAME_TIMESTAMPS_DSET);
+        hsize_t ts_dims = 0;
+        hsize_t ts_maxdims = H5S_UNLIMITED;
+        hid_t ts_space = H5Screate_simple(1, &ts_dims, &ts_maxdims);
+        assert(ts_space >= 0);
+        hid_t ts_prop = H5Pcreate(H5P_DATASET_CREATE);
+        assert(H5Pset_chunk(ts_prop, 1, &TIMESTAMPS_CHUNK) >= 0);
+        timestamps_dset = H5Dcreate2(this->fid, FRAME_TIMESTAMPS_DSET, H5T_NATIVE_UINT64,
+                                     ts_space, H5P_DEFAULT, ts_prop, H5P_DEFAULT);
+        assert(timestamps_dset >= 0);
+        assert(H5Pclose(ts_prop) >= 0);
+        assert(H5Sclose(ts_space) >= 0);
+        timestamps_written = 0;
+        pending_timestamps.clear();
+    }
 
     /* Enable SWMR writing mode */
-    assert(H5Fstart_swmr_write(this->fid) >= 0);
-    LOG4CXX_INFO(log, "##### SWMR mode ######");
-    LOG4CXX_INFO(log, "Clients can start reading");
-    if (!log->isInfoEnabled()) cout << "##### SWMR mode ######" << endl;
+    if (file_driver_supports_swmr(driver)) {
+        assert(H5Fstart_swmr_write(this->fid) >= 0);
+        LOG4CXX_INFO(log, "##### SWMR mode ######");
+        LOG4CXX_INFO(log, "Clients can start reading");
+        if (!log->isInfoEnabled()) cout << "##### SWMR mode ######" << endl;
+    } else {
+        LOG4CXX_WARN(log, "The " << file_driver_name(driver)
+                     << " file driver does not support SWMR: clients can not read");
+    }
+
+    if (flush_batch > 0) {
+        /* Keep the dataset's metadata in the cache during a batch of
+         * appends, and only let it out at the batch boundary */
+        LOG4CXX_INFO(log, "Coalescing metadata flushes: batches of " << flush_batch << " frames");
+        set_mdc_flushes(dataset, false);
+        if (frame_timestamps) set_mdc_flushes(timestamps_dset, false);
+    }
 
-	size_t databuf_nbytes = this->img.num_bytes_chunk(); // used for direct chunk write
+    if (direct) {
+        tiles.configure(frame_dims, chunk_dims, tile_threads);
+        LOG4CXX_DEBUG(log, "Direct chunk write: " << tiles.ntiles()
+                      << " tiles per frame, " << tiles.nthreads() << " packing thread(s)");
+    }
+
+    /* Real-time mode: no page faults on the frame buffers in the loop */
+    if (realtime.enabled()) {
+        realtime.lock_buffer(this->img.pdata(), this->img.num_bytes_img());
+        if (direct) {
+            for (size_t t = 0; t < tiles.buffers().size(); t++) {
+                realtime.lock_buffer(tiles.buffers()[t], tiles.buffer_bytes());
+            }
+        }
+    }
 
     TimeStamp ts;
+    TimeStamp call_ts;
+    TimeStamp frame_ts;
+    append_cost.clear();
+    cache_counters = ChunkCacheCounters();
+    cache_counters.traced = driver == DRIVER_TRACE;
+    uint64_t last_flush_ns = 0;
     LOG4CXX_DEBUG(log, "Starting write loop. Iterations: " << niter);
     bool show_pbar = not log->isDebugEnabled();
-    if (show_pbar) progressbar(0, niter);
+    ProgressBar pbar(niter, show_pbar && niter > 0 && !soak.enabled());
+    double img_mb = this->img.num_bytes_img() / (1024. * 1024.);
+    pbar.update(0);
     double writetime = 0.;
     double writerate = 0.;
     TimeStamp globaltime;
     globaltime.reset();
     ts.reset();
-    for (int i = 0; i < niter; i++) {
+    audit.baseline(this->fid);
+    realtime.start();
+    pacer.start();
+    soak.start();
+    /* Only a soak run, which stops on time or size, may leave niter unlimited */
+    bool soak_run = soak_duration > 0. || soak_max_mb > 0.;
+    unsigned int i;
+    for (i = 0; soak_run ? (niter == 0 || i < niter) : i < niter; i++) {
+        /* Soak mode: stop on time or size */
+        if (soak_duration > 0. && globaltime.seconds_until_now() >= soak_duration) break;
+        if (soak_max_mb > 0. && i * img_mb >= soak_max_mb) break;
+
+        pacer.wait(i);
+        frame_ts.reset();
+
+        bool extend = true;
+        if (direct) {
+            /* Copy the frame into its slot in each of the tile chunks */
+            {
+                SWMR_PROBE(PROBE_PACK);
+                call_ts.reset();
+                tiles.add_frame(this->img.pdata());
+                pack_latency.record(call_ts.nanoseconds_until_now());
+            }
+            // The frame is only written with its slab: stamp it when packed
+            if (frame_timestamps) pending_timestamps.push_back(TimeStamp::monotonic_now_ns());
+            /* Chunks are written whole: only extend once the slab is complete,
+             * so readers never see frames which have not been written yet */
+            extend = tiles.pending() == chunk_dims[0];
+        }
+
         /* Extend the dataset  */
-        LOG4CXX_TRACE(log, "Extending. Size: " << size[2]
-                      << ", " << size[1] << ", " << size[0]);
-        status = H5Dset_extent(dataset, size);
-        assert(status >= 0);
+        if (extend) {
+            LOG4CXX_TRACE(log, "Extending. Size: " << size[2]
+                          << ", " << size[1] << ", " << size[0]);
+            {
+                SWMR_PROBE(PROBE_EXTEND);
+                call_ts.reset();
+                status = H5Dset_extent(dataset, size);
+                extent_latency.record(call_ts.nanoseconds_until_now());
+            }
+            assert(status >= 0);
+        }
 
         if (direct) {
-        	uint32_t filter_mask = 0x0;
-        	status = H5DOwrite_chunk(dataset, H5P_DEFAULT,
-        							 filter_mask, offset,
-        							 databuf_nbytes, this->img.pdata());
+            if (extend) {
+                SWMR_PROBE(PROBE_WRITE);
+                call_ts.reset();
+                status = tiles.write(dataset, offset[0] + 1 - chunk_dims[0]);
+                uint64_t dt = call_ts.nanoseconds_until_now();
+                write_latency.record(dt);
+                soak.record_write(dt);
+            }
             assert(status >= 0);
+            if (extend && frame_timestamps) this->write_frame_timestamps();
         } else {
             /* Select a hyperslab */
-            filespace = H5Dget_space(dataset);
-            assert(filespace >= 0);
-            status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset, NULL,
-                                         img_dims, NULL);
+            {
+                SWMR_PROBE(PROBE_SELECT);
+                filespace = H5Dget_space(dataset);
+                assert(filespace >= 0);
+                status = H5Sselect_hyperslab(filespace, H5S_SELECT_SET, offset, NULL,
+                                             img_dims, NULL);
+            }
             assert(status >= 0);
 
             /* Write the data to the hyperslab */
             LOG4CXX_DEBUG(log, "Writing. Offset: " << offset[0] << ", "
                           << offset[1] << ", " << offset[2]);
-            status = H5Dwrite(dataset, H5T_NATIVE_UINT32, dataspace, filespace,
-            H5P_DEFAULT, this->img.pdata());
+            {
+                SWMR_PROBE(PROBE_WRITE);
+                uint64_t raw_io = cache_counters.traced ? IoTrace::raw_io_calls() : 0;
+                call_ts.reset();
+                status = H5Dwrite(dataset, H5T_NATIVE_UINT32, dataspace, filespace,
+                H5P_DEFAULT, this->img.pdata());
+                uint64_t dt = call_ts.nanoseconds_until_now();
+                cache_counters.accesses += chunks_per_frame;
+                if (cache_counters.traced) {
+                    cache_counters.raw_io += IoTrace::raw_io_calls() - raw_io;
+                }
+                write_latency.record(dt);
+                soak.record_write(dt);
+            }
             assert(status >= 0);
+            assert(H5Sclose(filespace) >= 0);
+            if (frame_timestamps) {
+                pending_timestamps.push_back(TimeStamp::monotonic_now_ns());
+                this->write_frame_timestamps();
+            }
         }
 
         /* Increment offsets and dimensions as appropriate */
         offset[0]++;
         size[0]++;
 
-        if ((i+1) % nframes_cache == 0)
+        if ((i+1) % flush_every == 0)
         {
             LOG4CXX_TRACE(log, "Flushing");
-            assert(H5Dflush(dataset) >= 0);
+            {
+                SWMR_PROBE(PROBE_FLUSH);
+                call_ts.reset();
+                if (flush_batch > 0) set_mdc_flushes(dataset, true);
+                status = H5Dflush(dataset);
+                if (flush_batch > 0) set_mdc_flushes(dataset, false);
+                last_flush_ns = call_ts.nanoseconds_until_now();
+                flush_latency.record(last_flush_ns);
+                soak.record_flush(last_flush_ns);
+            }
+            assert(status >= 0);
+            if (frame_timestamps) {
+                call_ts.reset();
+                if (flush_batch > 0) set_mdc_flushes(timestamps_dset, true);
+                status = H5Dflush(timestamps_dset);
+                if (flush_batch > 0) set_mdc_flushes(timestamps_dset, false);
+                timestamps_flush_latency.record(call_ts.nanoseconds_until_now());
+                assert(status >= 0);
+            }
             writetime = ts.seconds_until_now();
-            write_times.push_back(writetime);
+            if (nwrites == 0 || writetime < write_time_min) write_time_min = writetime;
+            if (nwrites == 0 || writetime > write_time_max) write_time_max = writetime;
+            write_time_sum += writetime;
+            write_time_sq_sum += writetime * writetime;
+            nwrites++;
             writerate = full_cache_size / writetime;
             LOG4CXX_DEBUG(log, "Writetime: " << writetime << " ["
                           << writerate << "MB/s]");
@@ -202,41 +443,318 @@ void SWMRWriter::write_test_data(unsigned int niter,
             dt_start = globaltime.seconds_until_now();
         }
 
-        if (show_pbar) progressbar(i+1, niter, writerate);
+        /* Append cost (extend + write + flush) by decade of dataset length */
+        size_t decade = static_cast<size_t>(log10(i + 1.0));
+        if (decade >= append_cost.size()) append_cost.resize(decade + 1);
+        append_cost[decade].record(frame_ts.nanoseconds_until_now());
+
+        if (record_batch > 0) {
+            FrameRecord rec = { i, TimeStamp::monotonic_now_ns(), exposure, frame_counts };
+            records.push_back(rec);
+            if (records.size() == record_batch) this->append_frame_records();
+        }
+
+        stats.update(i+1, last_flush_ns, 0);
+        if (soak.due()) {
+            bool drifted = false;
+            string line = soak.report(i+1, (i+1) * img_mb, drifted);
+            if (drifted) {
+                LOG4CXX_WARN(log, line);
+                if (!log->isWarnEnabled()) cout << line << endl;
+            } else {
+                LOG4CXX_INFO(log, line);
+                if (!log->isInfoEnabled()) cout << line << endl;
+            }
+        }
+        pbar.update(i+1, writerate);
+        audit.tick("write loop");
     }
 
+    /* No more metadata is held back: the last slab is flushed like the others */
+    if (flush_batch > 0) set_mdc_flushes(dataset, true);
+    if (direct && tiles.pending() > 0) {
+        /* Write out the last, partial, slab */
+        size[0] = i;
+        LOG4CXX_TRACE(log, "Extending. Size: " << size[2]
+                      << ", " << size[1] << ", " << size[0]);
+        if (H5Dset_extent(dataset, size) < 0 ||
+            tiles.write(dataset, i - tiles.pending()) < 0) {
+            throw runtime_error("Unable to write the last, partial, slab");
+        }
+        call_ts.reset();
+        status = H5Dflush(dataset);
+        last_flush_ns = call_ts.nanoseconds_until_now();
+        flush_latency.record(last_flush_ns);
+        if (status < 0) throw runtime_error("Unable to flush the last, partial, slab");
+    }
+    if (frame_timestamps) {
+        this->write_frame_timestamps();
+        if (flush_batch > 0) set_mdc_flushes(timestamps_dset, true);
+        assert(H5Dflush(timestamps_dset) >= 0);
+        assert(H5Dclose(timestamps_dset) >= 0);
+        timestamps_dset = -1;
+    }
+    if (record_batch > 0) {
+        this->append_frame_records();
+        assert(H5Dclose(record_dset) >= 0);
+        assert(H5PTclose(record_table) >= 0);
+        record_dset = -1;
+        record_table = -1;
+    }
+    realtime.finish();
+    stats.finish();
+    audit.check("write loop");
+
     dt_start = globaltime.seconds_until_now();
-    nframes = niter;
+    nframes = i;
 
     LOG4CXX_DEBUG(log, "Closing intermediate open HDF objects");
     assert( H5Dclose(dataset) >= 0);
+    image_dataset = -1;
     assert( H5Pclose(prop) >= 0);
     assert( H5Pclose(dapl) >= 0);
     assert( H5Sclose(dataspace) >= 0);
 }
 
+void SWMRWriter::set_driver(FileDriver driver, bool backing_store)
+{
+    if (!file_driver_available(driver)) {
+        throw runtime_error(string("File driver not built into the HDF5 library: ")
+                            + file_driver_name(driver));
+    }
+    this->driver = driver;
+    this->backing_store = backing_store;
+}
+
+void SWMRWriter::set_flush_batch(unsigned int frames)
+{
+    flush_batch = frames;
+}
+
+void SWMRWriter::set_mdc_log(const string& log_file)
+{
+    mdc_log = log_file;
+}
+
+herr_t SWMRWriter::object_flush_cb(hid_t object_id, void * udata)
+{
+    SWMRWriter * self = static_cast<SWMRWriter *>(udata);
+    // Not the flushes of the frame records or timestamps datasets
+    if (object_id != self->image_dataset) return 0;
+    uint64_t now = TimeStamp::now_ns();
+    if (self->last_object_flush_ns > 0) {
+        self->object_flush_interval.record(now - self->last_object_flush_ns);
+    }
+    self->last_object_flush_ns = now;
+    return 0;
+}
+
+void SWMRWriter::set_io_trace(const string& dump_file, size_t coalesce_bytes)
+{
+    trace_file = dump_file;
+    trace_coalesce = coalesce_bytes;
+}
+
+void SWMRWriter::publish_stats(const string& name)
+{
+    LOG4CXX_DEBUG(log, "Publishing live statistics in shared memory: " << name);
+    stats.publish(name, "writer");
+}
+
+void SWMRWriter::set_frame_records(unsigned int batch)
+{
+    record_batch = batch;
+}
+
+void SWMRWriter::append_frame_records()
+{
+    if (records.empty()) return;
+    TimeStamp ts;
+    assert(H5PTappend(record_table, records.size(), &records[0]) >= 0);
+    record_append_latency.record(ts.nanoseconds_until_now());
+    ts.reset();
+    assert(H5Dflush(record_dset) >= 0);
+    record_flush_latency.record(ts.nanoseconds_until_now());
+    records.clear();
+}
+
+void SWMRWriter::set_frame_timestamps(bool enable)
+{
+    frame_timestamps = enable;
+}
+
+void SWMRWriter::write_frame_timestamps()
+{
+    if (pending_timestamps.empty()) return;
+    TimeStamp ts;
+    hsize_t count = pending_timestamps.size();
+    hsize_t extent = timestamps_written + count;
+    assert(H5Dset_extent(timestamps_dset, &extent) >= 0);
+    hid_t filespace = H5Dget_space(timestamps_dset);
+    assert(filespace >= 0);
+    assert(H5Sselect_hyperslab(filespace, H5S_SELECT_SET, &timestamps_written, NULL,
+                               &count, NULL) >= 0);
+    hid_t memspace = H5Screate_simple(1, &count, NULL);
+    assert(memspace >= 0);
+    assert(H5Dwrite(timestamps_dset, H5T_NATIVE_UINT64, memspace, filespace,
+                    H5P_DEFAULT, &pending_timestamps[0]) >= 0);
+    assert(H5Sclose(memspace) >= 0);
+    assert(H5Sclose(filespace) >= 0);
+    timestamps_latency.record(ts.nanoseconds_until_now());
+    timestamps_written = extent;
+    pending_timestamps.clear();
+}
+
+void SWMRWriter::set_realtime(bool enable, int fifo_priority)
+{
+    realtime.configure(enable, fifo_priority);
+}
+
+void SWMRWriter::set_frame_rate(double rate_hz, unsigned int burst_frames,
+                                double burst_period)
+{
+    exposure = 1.0 / rate_hz;
+    LOG4CXX_DEBUG(log, "Pacing frames at " << rate_hz << "Hz. Burst: "
+                  << burst_frames << " frames every " << burst_period << "s");
+    pacer.configure(rate_hz, burst_frames, burst_period);
+}
+
+void SWMRWriter::set_soak(double duration, double max_size_mb,
+                          double interval, double drift_pct)
+{
+    LOG4CXX_DEBUG(log, "Soak mode. Duration: " << duration << "s Max size: "
+                  << max_size_mb << "MB Report interval: " << interval << "s");
+    soak_duration = duration;
+    soak_max_mb = max_size_mb;
+    soak.configure(interval, drift_pct);
+}
+
+void SWMRWriter::set_chunk_index(H5D_chunk_index_t index_type,
+                                 bool dont_filter_partial)
+{
+    assert(index_type == H5D_CHUNK_IDX_EARRAY || index_type == H5D_CHUNK_IDX_BT2);
+    chunk_index = index_type;
+    chunk_opts = dont_filter_partial ? H5D_CHUNK_DONT_FILTER_PARTIAL_CHUNKS : 0;
+}
+
+const char * SWMRWriter::chunk_index_name(H5D_chunk_index_t index_type)
+{
+    switch (index_type) {
+    case H5D_CHUNK_IDX_BTREE:  return "v1 B-tree";
+    case H5D_CHUNK_IDX_NONE:   return "none";
+    case H5D_CHUNK_IDX_FARRAY: return "fixed array";
+    case H5D_CHUNK_IDX_EARRAY: return "extensible array";
+    case H5D_CHUNK_IDX_BT2:    return "v2 B-tree";
+    default:                   return "unknown";
+    }
+}
+
+void SWMRWriter::set_chunk_cache(double mbytes)
+{
+    cache_mb = mbytes;
+}
+
+void SWMRWriter::set_tiling(hsize_t rows, hsize_t cols, unsigned int nthreads)
+{
+    tile_dims[0] = rows;
+    tile_dims[1] = cols;
+    tile_threads = nthreads;
+}
+
 void SWMRWriter::report()
 {
     ostringstream oss;
-    double sum = accumulate(write_times.begin(), write_times.end(), 0.0);
-    double mean = sum / write_times.size();
-
-    double sq_sum = inner_product(write_times.begin(), write_times.end(), write_times.begin(), 0.0);
-    double stdev = sqrt(sq_sum / write_times.size() - mean * mean);
+    double mean = 0.;
+    double stdev = 0.;
+    if (nwrites > 0) {
+        mean = write_time_sum / nwrites;
+        stdev = sqrt(max(write_time_sq_sum / nwrites - mean * mean, 0.));
+    }
     double imgsize = this->img.dimensions()[0] * this->img.dimensions()[1] * sizeof(uint32_t);
     imgsize = imgsize / (1024. * 1024); // in megabytes
     double dsetsize = imgsize * nframes;
 
     oss << endl << "======= SWMR writer report ========" << endl << endl
-        << " Number of writes: " << write_times.size() << endl
+        << " Number of writes: " << nwrites << endl
         << fixed << setprecision(1)
         << "    Overall time:    " << dt_start << "s\n"
-        << "            rate:    " << dsetsize/dt_start << "MB/s\n"
+        << "            rate:    " << (dt_start > 0. ? dsetsize / dt_start : 0.) << "MB/s\n"
         << fixed << setprecision(3)
         << " Mean write time:    " << mean << "s (stddev: "<< stdev << "s)\n"
-        << "             min:    " << *min_element(write_times.begin(), write_times.end()) << "s\n"
-        << "             max:    " << *max_element(write_times.begin(), write_times.end()) << "s\n"
+        << "             min:    " << write_time_min << "s\n"
+        << "             max:    " << write_time_max << "s\n"
         << endl;
+    LatencyHistogram::print_header(oss);
+    extent_latency.print(oss, "H5Dset_extent:");
+    if (direct_write) pack_latency.print(oss, "pack tiles:");
+    write_latency.print(oss, "write:");
+    flush_latency.print(oss, "H5Dflush:");
+    object_flush_interval.print(oss, "flush interval:");
+    if (record_batch > 0) {
+        record_append_latency.print(oss, "H5PTappend:");
+        record_flush_latency.print(oss, "records flush:");
+    }
+    if (frame_timestamps) {
+        timestamps_latency.print(oss, "timestamps:");
+        timestamps_flush_latency.print(oss, "timestamps flush:");
+    }
+    oss << endl;
+    if (record_batch > 0) {
+        oss << " Frame records: " << FRAME_RECORDS_DSET << ", appended in batches of "
+            << record_batch << " (" << sizeof(FrameRecord) << " bytes each)" << endl;
+    }
+    if (frame_timestamps) {
+        oss << " Frame timestamps: " << FRAME_TIMESTAMPS_DSET << ", "
+            << timestamps_written << " written" << endl;
+    }
+    if (flush_batch > 0) {
+        oss << " Metadata flushes: coalesced in batches of " << flush_batch << " frames" << endl;
+    }
+    oss << " File driver: " << file_driver_name(driver);
+    if (driver == DRIVER_CORE) {
+        oss << (backing_store ? " (with backing store)" : " (in memory only)");
+    }
+    if (!file_driver_supports_swmr(driver)) oss << ", SWMR disabled";
+    oss << endl;
+    oss << " Chunk index: " << SWMRWriter::chunk_index_name(chunk_index);
+    if (chunk_opts & H5D_CHUNK_DONT_FILTER_PARTIAL_CHUNKS) {
+        oss << " (partial edge chunks not filtered)";
+    }
+    oss << endl;
+    if (direct_write) {
+        oss << " Chunk cache:         bypassed (direct chunk write)" << endl
+            << " Tiles per frame:     " << tiles.ntiles()
+            << " (packed by " << tiles.nthreads() << " thread(s))" << endl;
+    } else {
+        print_chunk_cache(oss, cache_config, cache_counters);
+    }
+    double mdc_hit_rate = 0.;
+    if (this->fid >= 0 && H5Fget_mdc_hit_rate(this->fid, &mdc_hit_rate) >= 0) {
+        oss << " Metadata cache hit rate: " << setprecision(1)
+            << 100.0 * mdc_hit_rate << "%" << endl;
+    }
+    if (CpuPlacement::enabled()) {
+        oss << endl;
+        CpuPlacement::print(oss);
+    }
+    if (driver == DRIVER_TRACE) {
+        oss << endl;
+        IoTrace::print(oss, nframes);
+    }
+    oss << endl << " Append cost (extend+write+flush) vs dataset length:" << endl;
+    LatencyHistogram::print_header(oss);
+    for (size_t d = 0; d < append_cost.size(); d++) {
+        ostringstream label;
+        label << "<" << static_cast<unsigned long long>(pow(10.0, d + 1.0)) << ":";
+        append_cost[d].print(oss, label.str());
+    }
+    oss << endl;
+    realtime.print(oss);
+    pacer.print(oss);
+    soak.print_summary(oss);
+#ifdef SWMR_ENABLE_PROBES
+    Probes::print(oss);
+#endif
     if (not log->isDebugEnabled()) cout << oss.str();
     LOG4CXX_DEBUG(log, oss.str());
 }
@@ -248,5 +766,10 @@ SWMRWriter::~SWMRWriter()
         assert(H5Fclose(this->fid) >= 0);
         this->fid = -1;
     }
+    if (!trace_file.empty()) {
+        // After closing the file, so the trace includes the final flush
+        LOG4CXX_INFO(log, "Writing I/O trace: " << trace_file);
+        IoTrace::dump(trace_file);
+    }
 }
 
@@ -7,23 +7,103 @@
 #include <hdf5.h>
 
 #include "frame.h"
+#include "histogram.h"
+#include "livestats.h"
+#include "pacer.h"
+#include "soak.h"
+#include "chunkcache.h"
+#include "tilewriter.h"
+#include "filedriver.h"
+#include "objaudit.h"
+#include "framerecord.h"
+#include "frametimeline.h"
+#include "realtime.h"
 
 class SWMRWriter {
 public:
     SWMRWriter(const std::string& fname);
     ~SWMRWriter();
+    void set_driver(FileDriver driver, bool backing_store);
+    void set_flush_batch(unsigned int frames);
+    void set_mdc_log(const std::string& log_file);
+    void set_frame_records(unsigned int batch);
+    void set_frame_timestamps(bool enable);
+    void set_realtime(bool enable, int fifo_priority);
+    void set_io_trace(const std::string& dump_file, size_t coalesce_bytes);
     void create_file();
     void get_test_data();
     void get_test_data(const std::string& fname, const std::string& dsetname);
     void write_test_data(unsigned int niter, unsigned int nframes_cache, bool direct);
+    void publish_stats(const std::string& name);
+    void set_frame_rate(double rate_hz, unsigned int burst_frames = 0,
+                        double burst_period = 0.0);
+    void set_soak(double duration, double max_size_mb,
+                  double interval, double drift_pct);
+    void set_chunk_index(H5D_chunk_index_t index_type, bool dont_filter_partial);
+    void set_chunk_cache(double mbytes);
+    void set_tiling(hsize_t rows, hsize_t cols, unsigned int nthreads);
     void report();
 
+    static const char * chunk_index_name(H5D_chunk_index_t index_type);
+
 private:
+    static herr_t object_flush_cb(hid_t object_id, void * udata);
+    void append_frame_records();
+    void write_frame_timestamps();
+
     LoggerPtr log;
     hid_t fid;
     std::string filename;
+    FileDriver driver;
+    bool backing_store;                        // core driver only
+    std::string trace_file;                    // trace driver only
+    size_t trace_coalesce;
+    std::string mdc_log;                       // empty: no cache logging
     Frame img;
-    std::vector<double> write_times;
+    size_t nwrites;                            // running write time statistics
+    double write_time_sum;
+    double write_time_sq_sum;
+    double write_time_min;
+    double write_time_max;
+    LatencyHistogram extent_latency;
+    LatencyHistogram write_latency;
+    LatencyHistogram flush_latency;
+    LiveStats stats;
+    FramePacer pacer;
+    SoakReporter soak;
+    double soak_duration;
+    double soak_max_mb;
+    H5D_chunk_index_t chunk_index;
+    unsigned int chunk_opts;
+    std::vector<LatencyHistogram> append_cost; // per decade of dataset length
+    double cache_mb;                           // 0: auto-tune
+    bool direct_write;
+    hsize_t tile_dims[2];                      // 0: use the test data chunking
+    unsigned int tile_threads;
+    TileWriter tiles;
+    LatencyHistogram pack_latency;
+    ChunkCacheConfig cache_config;
+    ChunkCacheCounters cache_counters;
+    hsize_t chunks_per_frame;
+    ObjectAudit audit;
+    unsigned int flush_batch;                  // 0: flush every chunk
+    hid_t image_dataset;                       // flushes of other objects are not timed
+    uint64_t last_object_flush_ns;
+    LatencyHistogram object_flush_interval;
+    unsigned int record_batch;                 // 0: no per-frame records
+    double exposure;
+    hid_t record_table;                        // packet table
+    hid_t record_dset;                         // the same dataset, for flushing
+    std::vector<FrameRecord> records;          // not appended yet
+    LatencyHistogram record_append_latency;
+    LatencyHistogram record_flush_latency;
+    bool frame_timestamps;
+    hid_t timestamps_dset;
+    hsize_t timestamps_written;
+    std::vector<uint64_t> pending_timestamps;  // frames not in the image dataset yet
+    LatencyHistogram timestamps_latency;
+    LatencyHistogram timestamps_flush_latency;
+    RealtimeMode realtime;
     double dt_start;
     unsigned int nframes;
 };
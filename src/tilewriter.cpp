@@ -0,0 +1,193 @@
+#include <cstring>
+#include <cassert>
+#include <stdexcept>
+
+#include "hdf5.h"
+#include "hdf5_hl.h"
+#include "tilewriter.h"
+#include "placement.h"
+
+using namespace std;
+
+TileWriter::TileWriter()
+: m_tile_rows(0), m_tile_cols(0), m_chunk_items(0), m_pending(0),
+  m_frame(NULL), m_nthreads(1), m_quit(false)
+{
+    pthread_mutex_init(&m_setup, NULL);
+}
+
+TileWriter::~TileWriter()
+{
+    this->stop_threads();
+    this->free_buffers();
+    pthread_mutex_destroy(&m_setup);
+}
+
+void TileWriter::configure(const hsize_t frame_dims[2],
+                           const hsize_t chunk_dims[3],
+                           unsigned int nthreads)
+{
+    this->stop_threads();
+    this->free_buffers();
+
+    m_frame_dims[0] = frame_dims[0];
+    m_frame_dims[1] = frame_dims[1];
+    m_chunk_dims[0] = chunk_dims[0];
+    m_chunk_dims[1] = chunk_dims[1];
+    m_chunk_dims[2] = chunk_dims[2];
+    m_tile_rows = (frame_dims[0] + chunk_dims[1] - 1) / chunk_dims[1];
+    m_tile_cols = (frame_dims[1] + chunk_dims[2] - 1) / chunk_dims[2];
+    m_chunk_items = chunk_dims[0] * chunk_dims[1] * chunk_dims[2];
+    m_pending = 0;
+
+    for (size_t t = 0; t < this->ntiles(); t++) {
+        uint32_t * buf = new uint32_t[m_chunk_items];
+        memset(buf, 0, m_chunk_items * sizeof(uint32_t));
+        m_buffers.push_back(buf);
+    }
+    if (!m_buffers.empty()) CpuPlacement::note_buffer("tile buffers", m_buffers[0]);
+
+    // No point in having more threads than tiles
+    m_nthreads = nthreads < 1 ? 1 : nthreads;
+    if (m_nthreads > this->ntiles()) m_nthreads = this->ntiles();
+    if (m_nthreads > 1) {
+        m_quit = false;
+        if (pthread_barrier_init(&m_start, NULL, m_nthreads) != 0) {
+            m_nthreads = 1;
+            throw runtime_error("TileWriter: unable to create the start barrier");
+        }
+        if (pthread_barrier_init(&m_done, NULL, m_nthreads) != 0) {
+            pthread_barrier_destroy(&m_start);
+            m_nthreads = 1;
+            throw runtime_error("TileWriter: unable to create the done barrier");
+        }
+        m_workers.resize(m_nthreads);
+        for (unsigned int w = 0; w < m_nthreads; w++) {
+            m_workers[w].owner = this;
+            m_workers[w].id = w;
+        }
+        /* Worker 0 is the calling thread. The workers wait for all of them
+         * to be started before they use the barriers */
+        pthread_mutex_lock(&m_setup);
+        int err = 0;
+        for (unsigned int w = 1; w < m_nthreads && err == 0; w++) {
+            pthread_t thread;
+            err = pthread_create(&thread, NULL, TileWriter::worker_main, &m_workers[w]);
+            if (err == 0) m_threads.push_back(thread);
+        }
+        if (err != 0) m_quit = true;
+        pthread_mutex_unlock(&m_setup);
+        if (err != 0) {
+            for (size_t w = 0; w < m_threads.size(); w++) pthread_join(m_threads[w], NULL);
+            m_threads.clear();
+            m_workers.clear();
+            pthread_barrier_destroy(&m_start);
+            pthread_barrier_destroy(&m_done);
+            m_nthreads = 1;
+            throw runtime_error(string("TileWriter: unable to start packing threads: ")
+                                + strerror(err));
+        }
+    }
+}
+
+void * TileWriter::worker_main(void * arg)
+{
+    Worker * worker = static_cast<Worker *>(arg);
+    TileWriter * self = worker->owner;
+    pthread_mutex_lock(&self->m_setup);
+    bool quit = self->m_quit;
+    pthread_mutex_unlock(&self->m_setup);
+    if (quit) return NULL;
+    CpuPlacement::pin_thread("tile packer", worker->id);
+    for (;;) {
+        pthread_barrier_wait(&self->m_start);
+        if (self->m_quit) break;
+        self->pack(worker->id);
+        pthread_barrier_wait(&self->m_done);
+    }
+    return NULL;
+}
+
+void TileWriter::stop_threads()
+{
+    if (m_threads.empty()) return;
+    m_quit = true;
+    pthread_barrier_wait(&m_start);
+    for (size_t w = 0; w < m_threads.size(); w++) {
+        pthread_join(m_threads[w], NULL);
+    }
+    m_threads.clear();
+    m_workers.clear();
+    pthread_barrier_destroy(&m_start);
+    pthread_barrier_destroy(&m_done);
+}
+
+void TileWriter::free_buffers()
+{
+    for (size_t t = 0; t < m_buffers.size(); t++) delete [] m_buffers[t];
+    m_buffers.clear();
+}
+
+void TileWriter::pack(unsigned int worker)
+{
+    hsize_t tile_size = m_chunk_dims[1] * m_chunk_dims[2];
+    for (size_t t = worker; t < m_buffers.size(); t += m_nthreads) {
+        hsize_t row0 = (t / m_tile_cols) * m_chunk_dims[1];
+        hsize_t col0 = (t % m_tile_cols) * m_chunk_dims[2];
+        hsize_t nrows = m_chunk_dims[1];
+        hsize_t ncols = m_chunk_dims[2];
+        if (row0 + nrows > m_frame_dims[0]) nrows = m_frame_dims[0] - row0;
+        if (col0 + ncols > m_frame_dims[1]) ncols = m_frame_dims[1] - col0;
+
+        uint32_t * dst = m_buffers[t] + m_pending * tile_size;
+        const uint32_t * src = m_frame + row0 * m_frame_dims[1] + col0;
+        for (hsize_t r = 0; r < nrows; r++) {
+            memcpy(dst + r * m_chunk_dims[2], src + r * m_frame_dims[1],
+                   ncols * sizeof(uint32_t));
+        }
+    }
+}
+
+void TileWriter::add_frame(const uint32_t * frame)
+{
+    assert(m_pending < m_chunk_dims[0]);
+    m_frame = frame;
+    if (m_nthreads > 1) {
+        pthread_barrier_wait(&m_start);
+        this->pack(0);
+        pthread_barrier_wait(&m_done);
+    } else {
+        this->pack(0);
+    }
+    m_pending++;
+}
+
+herr_t TileWriter::write(hid_t dataset, hsize_t slab_offset)
+{
+    herr_t status = 0;
+    uint32_t filter_mask = 0x0;
+    for (size_t t = 0; t < m_buffers.size() && status >= 0; t++) {
+        hsize_t offset[3] = { slab_offset,
+                              (t / m_tile_cols) * m_chunk_dims[1],
+                              (t % m_tile_cols) * m_chunk_dims[2] };
+        status = H5DOwrite_chunk(dataset, H5P_DEFAULT, filter_mask, offset,
+                                 m_chunk_items * sizeof(uint32_t), m_buffers[t]);
+    }
+    m_pending = 0;
+    return status;
+}
+
+unsigned int TileWriter::pending() const
+{
+    return m_pending;
+}
+
+size_t TileWriter::ntiles() const
+{
+    return m_tile_rows * m_tile_cols;
+}
+
+unsigned int TileWriter::nthreads() const
+{
+    return m_nthreads;
+}
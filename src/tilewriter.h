@@ -0,0 +1,70 @@
+/*
+ * tilewriter.h
+ *
+ * Packs frames into whole chunks for the direct chunk write path.
+ *
+ * A frame is split into tiles of chunk_dims[1] x chunk_dims[2] pixels, each
+ * stored in its own chunk. A chunk holds chunk_dims[0] consecutive frames so
+ * each frame is copied (with the frame row stride) into its slot in every
+ * tile buffer. Once a slab of chunk_dims[0] frames has been packed, all the
+ * tiles are written with H5DOwrite_chunk() at their chunk aligned offsets.
+ * Tiles at the right and bottom edges of the frame are zero padded.
+ *
+ * Packing can be spread over a number of threads. The HDF5 calls themselves
+ * are always made from the calling thread.
+ */
+
+#ifndef TILEWRITER_H_
+#define TILEWRITER_H_
+
+#include <vector>
+#include <pthread.h>
+#include <stdint.h>
+#include <hdf5.h>
+
+class TileWriter {
+public:
+    TileWriter();
+    ~TileWriter();
+    void configure(const hsize_t frame_dims[2], const hsize_t chunk_dims[3],
+                   unsigned int nthreads = 1);
+    void add_frame(const uint32_t * frame);
+    herr_t write(hid_t dataset, hsize_t slab_offset);
+    unsigned int pending() const;
+    size_t ntiles() const;
+    unsigned int nthreads() const;
+    const std::vector<uint32_t *>& buffers() const { return m_buffers; }
+    size_t buffer_bytes() const { return m_chunk_items * sizeof(uint32_t); }
+
+private:
+    TileWriter(const TileWriter&);            // not copyable
+    TileWriter& operator=(const TileWriter&);
+
+    struct Worker {
+        TileWriter * owner;
+        unsigned int id;
+    };
+    static void * worker_main(void * arg);
+    void pack(unsigned int worker);
+    void stop_threads();
+    void free_buffers();
+
+    hsize_t m_frame_dims[2];
+    hsize_t m_chunk_dims[3];
+    hsize_t m_tile_rows;
+    hsize_t m_tile_cols;
+    size_t m_chunk_items;
+    std::vector<uint32_t *> m_buffers;   // one chunk per tile
+    unsigned int m_pending;
+    const uint32_t * m_frame;
+
+    unsigned int m_nthreads;
+    bool m_quit;
+    pthread_mutex_t m_setup;             // held while the threads are started
+    std::vector<pthread_t> m_threads;
+    std::vector<Worker> m_workers;
+    pthread_barrier_t m_start;
+    pthread_barrier_t m_done;
+};
+
+#endif /* TILEWRITER_H_ */
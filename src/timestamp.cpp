@@ -1,15 +1,26 @@
 #include "timestamp.h"
 
+#if defined(__x86_64__)
+#include <cpuid.h>
+#define TIMESTAMP_HAVE_TSC 1
+#endif
+
+// TSC backend state: selected once at startup, before any measurements.
+static bool g_tsc_enabled = false;
+static uint64_t g_tsc_mult = 0;       // ns per tick in 32.32 fixed point
+static double g_tsc_ghz = 0.0;
+
 TimeStamp::TimeStamp()
 {
-    this->start.tv_nsec = 0;
-    this->start.tv_sec = 0;
+    this->start = 0;
+    this->use_tsc = false;
     this->reset();
 }
 
 void TimeStamp::reset()
 {
-    clock_gettime( CLOCK_REALTIME, &this->start);
+    this->use_tsc = g_tsc_enabled;
+    this->start = TimeStamp::read_clock(this->use_tsc);
 }
 
 double TimeStamp::tsdiff(timespec& start, timespec& end) const
@@ -30,10 +41,88 @@ double TimeStamp::tsdiff(timespec& start, timespec& end) const
 }
 
 double TimeStamp::seconds_until_now()
+{
+    return this->nanoseconds_until_now() / 1E9;
+}
+
+uint64_t TimeStamp::nanoseconds_until_now()
+{
+    uint64_t now = TimeStamp::read_clock(this->use_tsc);
+    return TimeStamp::ticks_to_ns(now - this->start, this->use_tsc);
+}
+
+uint64_t TimeStamp::now_ns()
+{
+    return TimeStamp::ticks_to_ns(TimeStamp::read_clock(g_tsc_enabled),
+                                  g_tsc_enabled);
+}
+
+uint64_t TimeStamp::monotonic_now_ns()
 {
     timespec now;
-    clock_gettime( CLOCK_REALTIME, &now);
-    double stampdiff = this->tsdiff(this->start, now);
-    return stampdiff;
+    clock_gettime( CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+uint64_t TimeStamp::read_clock(bool tsc)
+{
+#ifdef TIMESTAMP_HAVE_TSC
+    if (tsc) return __builtin_ia32_rdtsc();
+#endif
+    return TimeStamp::monotonic_now_ns();
+}
+
+uint64_t TimeStamp::ticks_to_ns(uint64_t ticks, bool tsc)
+{
+#ifdef TIMESTAMP_HAVE_TSC
+    if (tsc) {
+        return static_cast<uint64_t>(
+                (static_cast<unsigned __int128>(ticks) * g_tsc_mult) >> 32);
+    }
+#endif
+    return ticks;
+}
+
+bool TimeStamp::enable_tsc()
+{
+#ifdef TIMESTAMP_HAVE_TSC
+    if (g_tsc_enabled) return true;
+
+    /* Only use the TSC if it is invariant (constant rate in all P/C states) */
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) return false;
+    if (!(edx & (1u << 8))) return false;
+
+    /* Calibrate against CLOCK_MONOTONIC over ~50ms */
+    timespec delay = { 0, 50000000 };
+    uint64_t ns0 = TimeStamp::monotonic_now_ns();
+    uint64_t tsc0 = __builtin_ia32_rdtsc();
+    nanosleep(&delay, NULL);
+    uint64_t ns1 = TimeStamp::monotonic_now_ns();
+    uint64_t tsc1 = __builtin_ia32_rdtsc();
+    if (tsc1 <= tsc0 || ns1 <= ns0) return false;
+
+    double ns_per_tick = static_cast<double>(ns1 - ns0) / (tsc1 - tsc0);
+    g_tsc_mult = static_cast<uint64_t>(ns_per_tick * 4294967296.0 + 0.5);
+    g_tsc_ghz = 1.0 / ns_per_tick;
+    g_tsc_enabled = true;
+    return true;
+#else
+    return false;
+#endif
 }
 
+void TimeStamp::disable_tsc()
+{
+    g_tsc_enabled = false;
+}
+
+bool TimeStamp::tsc_enabled()
+{
+    return g_tsc_enabled;
+}
+
+double TimeStamp::tsc_ghz()
+{
+    return g_tsc_ghz;
+}
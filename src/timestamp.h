@@ -2,16 +2,40 @@
 #define TIMESTAMP_H_
 
 #include <ctime>
+#include <stdint.h>
 
+/*
+ * Interval timer.
+ *
+ * By default intervals are measured against CLOCK_MONOTONIC so they are not
+ * affected by NTP or manual adjustments of the wall clock. On x86_64 an
+ * optional TSC backend can be enabled with TimeStamp::enable_tsc() which reads
+ * the CPU timestamp counter directly and converts ticks to nanoseconds with a
+ * fixed-point multiplier calibrated against CLOCK_MONOTONIC.
+ */
 class TimeStamp {
 public:
     TimeStamp();
     ~TimeStamp(){};
     void reset();
     double seconds_until_now();
+    uint64_t nanoseconds_until_now();
     double tsdiff(timespec& start, timespec& end) const;
+
+    static uint64_t now_ns();
+    static uint64_t monotonic_now_ns();  // CLOCK_MONOTONIC whatever the backend:
+                                         // comparable between processes
+    static bool enable_tsc();
+    static void disable_tsc();
+    static bool tsc_enabled();
+    static double tsc_ghz();
+
     private:
-    timespec start;
+    static uint64_t read_clock(bool tsc);
+    static uint64_t ticks_to_ns(uint64_t ticks, bool tsc);
+
+    uint64_t start;
+    bool use_tsc;
 };
 
 #endif /* TIMESTAMP_H_ */
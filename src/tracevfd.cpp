@@ -0,0 +1,432 @@
+#include <vector>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <cstdlib>
+#include <cstring>
+#include <assert.h>
+#include <sys/file.h>
+
+#include "hdf5.h"
+#include "histogram.h"
+#include "timestamp.h"
+#include "tracevfd.h"
+
+using namespace std;
+
+/* HDF5 1.10 passes the memory type to get_eof and changed the type of the
+ * flush 'closing' argument */
+#if H5_VERSION_GE(1, 10, 0)
+#define TRACE_EOF_ARGS(file, type) (file, type)
+typedef hbool_t trace_closing_t;
+#else
+#define TRACE_EOF_ARGS(file, type) (file)
+typedef unsigned trace_closing_t;
+#endif
+
+/* Same address limit as the sec2 driver */
+#define TRACE_MAXADDR (((haddr_t)1 << (8 * sizeof(off_t) - 1)) - 1)
+
+struct TraceFapl {
+    size_t coalesce_bytes;   // 0: no coalescing
+    hbool_t keep_records;
+};
+
+struct TraceFile {
+    H5FD_t pub;              // public part, must be first
+    H5FD_t * inner;          // the wrapped sec2 file
+    TraceFapl fa;
+    vector<char> pending;    // coalesced writes not yet issued
+    haddr_t pending_addr;
+    H5FD_mem_t pending_type;
+    uint32_t pending_merged;
+};
+
+/* Per process trace, see tracevfd.h */
+struct OpStats {
+    uint64_t calls;
+    uint64_t bytes;
+    uint64_t sequential;     // started where the previous op of its kind ended
+};
+
+static hid_t g_driver_id = -1;
+static uint64_t g_t0 = 0;
+static OpStats g_stats[2][IoTraceRecord::nops];   // [metadata, raw data][op]
+static haddr_t g_last_end[2][IoTraceRecord::nops]; // [metadata, raw data][op]
+static LatencyHistogram g_latency[IoTraceRecord::nops];
+static uint64_t g_library_writes = 0;
+static TraceFapl g_fapl = { 0, false };
+static vector<IoTraceRecord> g_records;
+
+static const char * op_name(int op)
+{
+    switch (op) {
+    case IoTraceRecord::read:     return "read";
+    case IoTraceRecord::write:    return "write";
+    case IoTraceRecord::truncate: return "truncate";
+    case IoTraceRecord::flush:    return "flush";
+    default:                      return "unknown";
+    }
+}
+
+static const char * mem_type_name(int type)
+{
+    switch (type) {
+    case H5FD_MEM_SUPER: return "super";
+    case H5FD_MEM_BTREE: return "btree";
+    case H5FD_MEM_DRAW:  return "draw";
+    case H5FD_MEM_GHEAP: return "gheap";
+    case H5FD_MEM_LHEAP: return "lheap";
+    case H5FD_MEM_OHDR:  return "ohdr";
+    default:             return "-";
+    }
+}
+
+static void trace_reset(const TraceFapl& fa)
+{
+    g_t0 = TimeStamp::now_ns();
+    memset(g_stats, 0, sizeof(g_stats));
+    for (int op = 0; op < IoTraceRecord::nops; op++) {
+        g_last_end[0][op] = HADDR_UNDEF;
+        g_last_end[1][op] = HADDR_UNDEF;
+        g_latency[op].reset();
+    }
+    g_library_writes = 0;
+    g_fapl = fa;
+    g_records.clear();
+}
+
+static void trace_record(int op, H5FD_mem_t type, haddr_t addr, size_t size,
+                         uint64_t start_ns, uint64_t latency_ns, uint32_t merged)
+{
+    int raw = type == H5FD_MEM_DRAW ? 1 : 0;
+    OpStats& stats = g_stats[raw][op];
+    stats.calls++;
+    stats.bytes += size;
+    if (addr == g_last_end[raw][op]) stats.sequential++;
+    g_last_end[raw][op] = addr + size;
+    g_latency[op].record(latency_ns);
+    if (g_fapl.keep_records) {
+        IoTraceRecord rec;
+        rec.t_ns = start_ns - g_t0;
+        rec.addr = addr;
+        rec.size = size;
+        rec.latency_ns = latency_ns;
+        rec.op = op;
+        rec.type = type;
+        rec.merged = merged;
+        g_records.push_back(rec);
+    }
+}
+
+/* Issue the coalesced writes held back so far */
+static herr_t trace_issue_pending(TraceFile * file, hid_t dxpl)
+{
+    if (file->pending.empty()) return 0;
+    uint64_t start = TimeStamp::now_ns();
+    herr_t status = H5FDwrite(file->inner, file->pending_type, dxpl,
+                              file->pending_addr, file->pending.size(),
+                              &file->pending[0]);
+    trace_record(IoTraceRecord::write, file->pending_type, file->pending_addr,
+                 file->pending.size(), start, TimeStamp::now_ns() - start,
+                 file->pending_merged);
+    file->pending.clear();
+    file->pending_merged = 0;
+    return status;
+}
+
+/* Driver callbacks */
+
+static void * trace_fapl_copy(const void * fapl)
+{
+    TraceFapl * copy = static_cast<TraceFapl *>(malloc(sizeof(TraceFapl)));
+    if (copy != NULL) memcpy(copy, fapl, sizeof(TraceFapl));
+    return copy;
+}
+
+static herr_t trace_fapl_free(void * fapl)
+{
+    free(fapl);
+    return 0;
+}
+
+static void * trace_fapl_get(H5FD_t * _file)
+{
+    TraceFile * file = reinterpret_cast<TraceFile *>(_file);
+    return trace_fapl_copy(&file->fa);
+}
+
+static H5FD_t * trace_open(const char * name, unsigned flags, hid_t fapl,
+                           haddr_t maxaddr)
+{
+    TraceFapl fa = { 0, false };
+    const TraceFapl * fa_in = static_cast<const TraceFapl *>(H5Pget_driver_info(fapl));
+    if (fa_in != NULL) fa = *fa_in;
+
+    hid_t inner_fapl = H5Pcreate(H5P_FILE_ACCESS);
+    if (inner_fapl < 0) return NULL;
+    H5FD_t * inner = NULL;
+    if (H5Pset_fapl_sec2(inner_fapl) >= 0) {
+        inner = H5FDopen(name, flags, inner_fapl, maxaddr);
+    }
+    H5Pclose(inner_fapl);
+    if (inner == NULL) return NULL;
+
+    TraceFile * file = new TraceFile();
+    file->inner = inner;
+    file->fa = fa;
+    file->pending_addr = HADDR_UNDEF;
+    file->pending_type = H5FD_MEM_DEFAULT;
+    file->pending_merged = 0;
+    trace_reset(fa);
+    return &file->pub;
+}
+
+static herr_t trace_close(H5FD_t * _file)
+{
+    TraceFile * file = reinterpret_cast<TraceFile *>(_file);
+    herr_t status = trace_issue_pending(file, H5P_DEFAULT);
+    if (H5FDclose(file->inner) < 0) status = -1;
+    delete file;
+    return status;
+}
+
+static int trace_cmp(const H5FD_t * f1, const H5FD_t * f2)
+{
+    return H5FDcmp(reinterpret_cast<const TraceFile *>(f1)->inner,
+                   reinterpret_cast<const TraceFile *>(f2)->inner);
+}
+
+static herr_t trace_query(const H5FD_t * _file, unsigned long * flags)
+{
+    if (_file != NULL) {
+        const TraceFile * file = reinterpret_cast<const TraceFile *>(_file);
+        return H5FDquery(file->inner, flags) < 0 ? -1 : 0;
+    }
+    /* No file yet: the feature flags of sec2 */
+    *flags = H5FD_FEAT_AGGREGATE_METADATA | H5FD_FEAT_ACCUMULATE_METADATA |
+             H5FD_FEAT_DATA_SIEVE | H5FD_FEAT_AGGREGATE_SMALLDATA |
+             H5FD_FEAT_POSIX_COMPAT_HANDLE;
+#ifdef H5FD_FEAT_SUPPORTS_SWMR_IO
+    *flags |= H5FD_FEAT_SUPPORTS_SWMR_IO;
+#endif
+    return 0;
+}
+
+static haddr_t trace_get_eoa(const H5FD_t * _file, H5FD_mem_t type)
+{
+    const TraceFile * file = reinterpret_cast<const TraceFile *>(_file);
+    return H5FDget_eoa(file->inner, type);
+}
+
+static herr_t trace_set_eoa(H5FD_t * _file, H5FD_mem_t type, haddr_t addr)
+{
+    TraceFile * file = reinterpret_cast<TraceFile *>(_file);
+    return H5FDset_eoa(file->inner, type, addr);
+}
+
+#if H5_VERSION_GE(1, 10, 0)
+static haddr_t trace_get_eof(const H5FD_t * _file, H5FD_mem_t type)
+#else
+static haddr_t trace_get_eof(const H5FD_t * _file)
+#endif
+{
+    const TraceFile * file = reinterpret_cast<const TraceFile *>(_file);
+    haddr_t eof = H5FDget_eof TRACE_EOF_ARGS(file->inner, type);
+    if (!file->pending.empty() && eof != HADDR_UNDEF) {
+        eof = max<haddr_t>(eof, file->pending_addr + file->pending.size());
+    }
+    return eof;
+}
+
+static herr_t trace_get_handle(H5FD_t * _file, hid_t fapl, void ** handle)
+{
+    TraceFile * file = reinterpret_cast<TraceFile *>(_file);
+    return H5FDget_vfd_handle(file->inner, fapl, handle);
+}
+
+static herr_t trace_read(H5FD_t * _file, H5FD_mem_t type, hid_t dxpl,
+                         haddr_t addr, size_t size, void * buf)
+{
+    TraceFile * file = reinterpret_cast<TraceFile *>(_file);
+    if (trace_issue_pending(file, dxpl) < 0) return -1;
+    uint64_t start = TimeStamp::now_ns();
+    herr_t status = H5FDread(file->inner, type, dxpl, addr, size, buf);
+    trace_record(IoTraceRecord::read, type, addr, size, start,
+                 TimeStamp::now_ns() - start, 1);
+    return status;
+}
+
+static herr_t trace_write(H5FD_t * _file, H5FD_mem_t type, hid_t dxpl,
+                          haddr_t addr, size_t size, const void * buf)
+{
+    TraceFile * file = reinterpret_cast<TraceFile *>(_file);
+    g_library_writes++;
+    if (size < file->fa.coalesce_bytes) {
+        bool follows = !file->pending.empty() && type == file->pending_type &&
+                       addr == file->pending_addr + file->pending.size() &&
+                       file->pending.size() + size <= file->fa.coalesce_bytes;
+        if (!follows) {
+            if (trace_issue_pending(file, dxpl) < 0) return -1;
+            file->pending_addr = addr;
+            file->pending_type = type;
+        }
+        const char * p = static_cast<const char *>(buf);
+        file->pending.insert(file->pending.end(), p, p + size);
+        file->pending_merged++;
+        return 0;
+    }
+    if (trace_issue_pending(file, dxpl) < 0) return -1;
+    uint64_t start = TimeStamp::now_ns();
+    herr_t status = H5FDwrite(file->inner, type, dxpl, addr, size, buf);
+    trace_record(IoTraceRecord::write, type, addr, size, start,
+                 TimeStamp::now_ns() - start, 1);
+    return status;
+}
+
+static herr_t trace_flush(H5FD_t * _file, hid_t dxpl, trace_closing_t closing)
+{
+    TraceFile * file = reinterpret_cast<TraceFile *>(_file);
+    if (trace_issue_pending(file, dxpl) < 0) return -1;
+    uint64_t start = TimeStamp::now_ns();
+    herr_t status = H5FDflush(file->inner, dxpl, closing);
+    trace_record(IoTraceRecord::flush, H5FD_MEM_DEFAULT, 0, 0, start,
+                 TimeStamp::now_ns() - start, 0);
+    return status;
+}
+
+static herr_t trace_truncate(H5FD_t * _file, hid_t dxpl, hbool_t closing)
+{
+    TraceFile * file = reinterpret_cast<TraceFile *>(_file);
+    if (trace_issue_pending(file, dxpl) < 0) return -1;
+    uint64_t start = TimeStamp::now_ns();
+    herr_t status = H5FDtruncate(file->inner, dxpl, closing);
+    trace_record(IoTraceRecord::truncate, H5FD_MEM_DEFAULT,
+                 H5FDget_eoa(file->inner, H5FD_MEM_DEFAULT), 0, start,
+                 TimeStamp::now_ns() - start, 0);
+    return status;
+}
+
+/* Locking as in sec2, on the wrapped file's descriptor */
+static herr_t trace_lock(H5FD_t * _file, hbool_t rw)
+{
+    int * fd = NULL;
+    if (trace_get_handle(_file, H5P_DEFAULT, reinterpret_cast<void **>(&fd)) < 0) return -1;
+    return flock(*fd, (rw ? LOCK_EX : LOCK_SH) | LOCK_NB) < 0 ? -1 : 0;
+}
+
+static herr_t trace_unlock(H5FD_t * _file)
+{
+    int * fd = NULL;
+    if (trace_get_handle(_file, H5P_DEFAULT, reinterpret_cast<void **>(&fd)) < 0) return -1;
+    return flock(*fd, LOCK_UN) < 0 ? -1 : 0;
+}
+
+static const H5FD_class_t trace_class = {
+    "swmr-trace",             /* name                 */
+    TRACE_MAXADDR,            /* maxaddr              */
+    H5F_CLOSE_WEAK,           /* fc_degree            */
+    NULL,                     /* terminate            */
+    NULL,                     /* sb_size              */
+    NULL,                     /* sb_encode            */
+    NULL,                     /* sb_decode            */
+    sizeof(TraceFapl),        /* fapl_size            */
+    trace_fapl_get,           /* fapl_get             */
+    trace_fapl_copy,          /* fapl_copy            */
+    trace_fapl_free,          /* fapl_free            */
+    0,                        /* dxpl_size            */
+    NULL,                     /* dxpl_copy            */
+    NULL,                     /* dxpl_free            */
+    trace_open,               /* open                 */
+    trace_close,              /* close                */
+    trace_cmp,                /* cmp                  */
+    trace_query,              /* query                */
+    NULL,                     /* get_type_map         */
+    NULL,                     /* alloc                */
+    NULL,                     /* free                 */
+    trace_get_eoa,            /* get_eoa              */
+    trace_set_eoa,            /* set_eoa              */
+    trace_get_eof,            /* get_eof              */
+    trace_get_handle,         /* get_handle           */
+    trace_read,               /* read                 */
+    trace_write,              /* write                */
+    trace_flush,              /* flush                */
+    trace_truncate,           /* truncate             */
+    trace_lock,               /* lock                 */
+    trace_unlock,             /* unlock               */
+    H5FD_FLMAP_DICHOTOMY      /* fl_map               */
+};
+
+hid_t IoTrace::driver_id()
+{
+    if (g_driver_id < 0 || H5Iget_type(g_driver_id) != H5I_VFL) {
+        g_driver_id = H5FDregister(&trace_class);
+        assert(g_driver_id >= 0);
+    }
+    return g_driver_id;
+}
+
+void IoTrace::set_fapl(hid_t fapl, size_t coalesce_bytes, bool keep_records)
+{
+    TraceFapl fa;
+    fa.coalesce_bytes = coalesce_bytes;
+    fa.keep_records = keep_records;
+    assert(H5Pset_driver(fapl, IoTrace::driver_id(), &fa) >= 0);
+}
+
+uint64_t IoTrace::raw_io_calls()
+{
+    return g_stats[1][IoTraceRecord::read].calls + g_stats[1][IoTraceRecord::write].calls;
+}
+
+void IoTrace::print(ostream& os, unsigned long long nframes)
+{
+    os << " I/O trace (sec2";
+    if (g_fapl.coalesce_bytes > 0) {
+        os << ", coalescing writes < " << g_fapl.coalesce_bytes << " bytes";
+    }
+    os << "):" << endl
+       << setw(18) << "[op]" << setw(10) << "calls" << setw(12) << "MBytes"
+       << setw(10) << "seq[%]" << setw(12) << "per frame" << endl;
+    for (int raw = 0; raw < 2; raw++) {
+        for (int op = IoTraceRecord::read; op <= IoTraceRecord::write; op++) {
+            const OpStats& s = g_stats[raw][op];
+            string name = string(raw ? "raw " : "meta ") + op_name(op) + ":";
+            os << setw(18) << name << setw(10) << s.calls
+               << setw(12) << fixed << setprecision(3) << s.bytes / (1024. * 1024.)
+               << setw(10) << setprecision(1)
+               << (s.calls > 0 ? 100. * s.sequential / s.calls : 0.)
+               << setw(12) << setprecision(2)
+               << (nframes > 0 ? double(s.calls) / nframes : 0.) << endl;
+        }
+    }
+    for (int op = IoTraceRecord::truncate; op < IoTraceRecord::nops; op++) {
+        uint64_t calls = g_stats[0][op].calls;
+        os << setw(18) << string(op_name(op)) + ":" << setw(10) << calls
+           << setw(34) << setprecision(2)
+           << (nframes > 0 ? double(calls) / nframes : 0.) << endl;
+    }
+    if (g_fapl.coalesce_bytes > 0) {
+        os << " Library writes: " << g_library_writes << " issued as "
+           << g_stats[0][IoTraceRecord::write].calls + g_stats[1][IoTraceRecord::write].calls
+           << " writes" << endl;
+    }
+    LatencyHistogram::print_header(os);
+    for (int op = 0; op < IoTraceRecord::nops; op++) {
+        if (g_latency[op].count() > 0) g_latency[op].print(os, string(op_name(op)) + ":");
+    }
+}
+
+void IoTrace::dump(const string& fname)
+{
+    ofstream out(fname.c_str());
+    if (!out) throw runtime_error("Unable to write I/O trace: " + fname);
+    out << "# t_us,op,type,addr,size,latency_us,merged" << endl;
+    out << fixed << setprecision(3);
+    for (size_t i = 0; i < g_records.size(); i++) {
+        const IoTraceRecord& r = g_records[i];
+        out << r.t_ns / 1000. << "," << op_name(r.op) << ","
+            << mem_type_name(r.type) << "," << r.addr << "," << r.size << ","
+            << r.latency_ns / 1000. << "," << r.merged << endl;
+    }
+}
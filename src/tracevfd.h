@@ -0,0 +1,51 @@
+/*
+ * tracevfd.h
+ *
+ * A virtual file driver which wraps sec2 and traces the I/O which the HDF5
+ * library issues: every read, write, truncate and flush with its offset,
+ * size and latency, split into metadata and raw data by memory type.
+ *
+ * Optionally, small writes which follow on directly from the previous write
+ * are coalesced into a single write to the sec2 file. Pending writes are
+ * issued before any other operation (a read, a write elsewhere, truncate,
+ * flush or close), so the order in which the bytes reach the file is the
+ * order in which the library wrote them, which SWMR readers rely on.
+ *
+ * The trace records the writes as issued to the file, so a coalesced write
+ * is one record.
+ *
+ * All calls into the driver are serialised by the library, so the trace is
+ * recorded without locking. There is one trace per process: it is reset
+ * when a file is opened with the driver.
+ */
+
+#ifndef TRACEVFD_H_
+#define TRACEVFD_H_
+
+#include <string>
+#include <ostream>
+#include <stdint.h>
+#include <hdf5.h>
+
+struct IoTraceRecord {
+    enum { read = 0, write, truncate, flush, nops };
+
+    uint64_t t_ns;           // since the file was opened
+    uint64_t addr;
+    uint64_t size;
+    uint64_t latency_ns;
+    uint32_t merged;         // library writes in this write (coalescing)
+    uint8_t op;
+    uint8_t type;            // H5FD_mem_t
+};
+
+class IoTrace {
+public:
+    static hid_t driver_id();
+    static void set_fapl(hid_t fapl, size_t coalesce_bytes, bool keep_records);
+    static uint64_t raw_io_calls();
+    static void print(std::ostream& os, unsigned long long nframes);
+    static void dump(const std::string& fname);
+};
+
+#endif /* TRACEVFD_H_ */